@@ -1,6 +1,7 @@
 #ifndef __PROTOBUF_FIELD_H__
 #define __PROTOBUF_FIELD_H__
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
 
 namespace serialflex {
@@ -0,0 +1,98 @@
+#ifndef __SERIALFLEX_FLAT_MAP_H__
+#define __SERIALFLEX_FLAT_MAP_H__
+
+#include <stddef.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace serialflex {
+
+// Sorted vector of key/value pairs, serialized like std::map. Lookups are a binary search over
+// one contiguous block and inserting in key order appends, which is how decoders fill it from
+// input written by the encoders. Inserting elsewhere shifts the tail, so build large maps in
+// order or with reserve() and insert() at end().
+template <typename K, typename V>
+class FlatMap {
+public:
+    typedef K key_type;
+    typedef V mapped_type;
+    typedef std::pair<K, V> value_type;
+    typedef typename std::vector<value_type>::iterator iterator;
+    typedef typename std::vector<value_type>::const_iterator const_iterator;
+
+private:
+    std::vector<value_type> items_;
+
+    struct KeyLess {
+        bool operator()(const value_type& item, const K& key) const { return item.first < key; }
+    };
+
+public:
+    iterator begin() { return items_.begin(); }
+    iterator end() { return items_.end(); }
+    const_iterator begin() const { return items_.begin(); }
+    const_iterator end() const { return items_.end(); }
+    size_t size() const { return items_.size(); }
+    bool empty() const { return items_.empty(); }
+    void clear() { items_.clear(); }
+    void reserve(size_t size) { items_.reserve(size); }
+    void swap(FlatMap& other) { items_.swap(other.items_); }
+
+    iterator lower_bound(const K& key) {
+        return std::lower_bound(items_.begin(), items_.end(), key, KeyLess());
+    }
+    const_iterator lower_bound(const K& key) const {
+        return std::lower_bound(items_.begin(), items_.end(), key, KeyLess());
+    }
+    iterator find(const K& key) {
+        iterator it = lower_bound(key);
+        return (it != items_.end() && !(key < it->first)) ? it : items_.end();
+    }
+    const_iterator find(const K& key) const {
+        const_iterator it = lower_bound(key);
+        return (it != items_.end() && !(key < it->first)) ? it : items_.end();
+    }
+    size_t count(const K& key) const { return (find(key) != items_.end()) ? 1 : 0; }
+
+    // the element with key, or where it belongs and false when there is none
+    std::pair<iterator, bool> insert(const value_type& item) {
+        iterator it = position(item.first);
+        if (it != items_.end() && !(item.first < it->first)) {
+            return std::pair<iterator, bool>(it, false);
+        }
+        return std::pair<iterator, bool>(items_.insert(it, item), true);
+    }
+    // hint is not needed, an item past the last key is appended either way
+    iterator insert(const_iterator hint, const value_type& item) {
+        (void)hint;
+        return insert(item).first;
+    }
+    V& operator[](const K& key) { return insert(value_type(key, V())).first->second; }
+
+    iterator erase(iterator it) { return items_.erase(it); }
+    size_t erase(const K& key) {
+        iterator it = find(key);
+        if (it == items_.end()) {
+            return 0;
+        }
+        items_.erase(it);
+        return 1;
+    }
+
+    bool operator==(const FlatMap& other) const { return items_ == other.items_; }
+    bool operator!=(const FlatMap& other) const { return items_ != other.items_; }
+
+private:
+    // the end when key sorts after the last element, which skips the search for ordered input
+    iterator position(const K& key) {
+        if (items_.empty() || items_.back().first < key) {
+            return items_.end();
+        }
+        return lower_bound(key);
+    }
+};
+
+}// namespace serialflex
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <map>
 #include <serialflex/field.h>
+#include <serialflex/parallel.h>
 #include <serialflex/traits.h>
 
 namespace serialflex {
@@ -11,22 +12,40 @@ namespace json {
 class Reader;
 }// namespace json
 
-struct GenericNode;
+struct TapeNode;
 class EXPORTAPI JSONDecoder {
     bool convert_by_type_; // convert by field type
     bool case_insensitive_;// key case insensitive
+    bool padded_;          // INPUT_PADDING zero bytes follow length-delimited input
     json::Reader* reader_;
-    const GenericNode* current_;
+    const TapeNode* current_;
+    uint32_t threads_;
+    std::vector<JSONDecoder*> workers_;// decode ranges of items, kept for the next document
 
     JSONDecoder(const JSONDecoder&);
     JSONDecoder& operator=(const JSONDecoder&);
 
 public:
+    JSONDecoder();
     JSONDecoder(const char* str, bool case_insensitive = false);
+    // data needs no '\0' terminator
+    JSONDecoder(const char* data, size_t len, bool case_insensitive = false);
     ~JSONDecoder();
 
+    // parse a new document, the node storage of the previous one is reused
+    bool reset(const char* str);
+    bool reset(const char* data, size_t len);
+    // length-delimited input is followed by INPUT_PADDING readable zero bytes
+    JSONDecoder& setPadded(bool padded);
+    // key case insensitive
+    JSONDecoder& setCaseInsensitive(bool case_insensitive);
+
     // convert by field type
     JSONDecoder& setConvertByType(bool convert_by_type);
+    // Arrays of PARALLEL_ITEMS items or more, at the root or in a field, are decoded by up to
+    // threads threads in ranges of items. An error names the first item that failed, which
+    // makes it the same from run to run. 1 by default.
+    JSONDecoder& setThreads(uint32_t threads);
     
     const char* getError() const;
 
@@ -47,8 +66,10 @@ public:
         if (!current_) {
             return false;
         }
-        const GenericNode* parent = current_;
+        const TapeNode* parent = current_;
+        enterShape(&internal::TypeKey<T>::id);
         internal::serializeWrapper(*this, value);
+        leaveShape();
 
         if (parent != current_) {
             return false;
@@ -59,59 +80,59 @@ public:
         return true;
     }
 
+    // numeric vectors take the bulk path here as well
     template <typename T>
     bool operator>>(std::vector<T>& value) {
-        if (!current_) {
-            return false;
-        }
-        const GenericNode* parent = current_;
-        uint32_t size = JSONDecoder::getObjectSize(current_);
-        if (size) {
-            value.resize(size);
-        }
-        const GenericNode* parent_temp = current_;
-        current_ = JSONDecoder::getChild(current_);
-        for (uint32_t idx = 0; current_ && (idx < size);
-             (current_ = JSONDecoder::getNext(current_)), ++idx) {
-            decodeValue(NULL, *(typename internal::TypeTraits<T>::Type*)(&value.at(idx)), NULL);
-        }
-        current_ = parent_temp;
+        return decodeRoot(value);
+    }
 
-        if (parent != current_) {
-            return false;
-        }
-        if (getError()) {
-            return false;
-        }
-        return true;
+    template <typename T, size_t N>
+    bool operator>>(SmallVector<T, N>& value) {
+        return decodeRoot(value);
+    }
+
+    template <typename T, size_t N>
+    bool operator>>(T (&value)[N]) {
+        return decodeRoot(value);
     }
 
+#if __cplusplus >= 201103L
+    template <typename T, size_t N>
+    bool operator>>(std::array<T, N>& value) {
+        return decodeRoot(value);
+    }
+#endif
+
     template <typename K, typename V>
     bool operator>>(std::map<K, V>& value) {
-        if (!current_) {
-            return false;
-        }
-        const GenericNode* parent = current_;
-        value.clear();
-        const GenericNode* parent_temp = current_;
-        for (const GenericNode* child = JSONDecoder::getChild(parent); child;
-             child = JSONDecoder::getNext(child)) {
-            std::string key(JSONDecoder::getKey(child), JSONDecoder::getKeySize(child));
-            V item = V();
-            decodeValue(key.c_str(), *((typename internal::TypeTraits<V>::Type*)(&item)), NULL);
-            value.insert(std::pair<K, V>(internal::STOT::type<K>::strto(key.c_str()), item));
-        }
-        current_ = parent_temp;
-        return (parent == current_);
+        return decodeRoot(value);
+    }
+
+    template <typename K, typename V>
+    bool operator>>(FlatMap<K, V>& value) {
+        return decodeRoot(value);
     }
 
+#if __cplusplus >= 201103L
+    template <typename K, typename V>
+    bool operator>>(std::unordered_map<K, V>& value) {
+        return decodeRoot(value);
+    }
+#endif
+
+    enum { PARALLEL_ITEMS = 1024 };
+
 private:
+    enum { RANGE_ITEMS = 256, RANGES_PER_THREAD = 8 };
+
     template <typename T>
     void decodeValue(const char* name, T& value, bool* has_value) {
-        const GenericNode* parent = current_;
+        const TapeNode* parent = current_;
         current_ = JSONDecoder::getObjectItem(current_, name, case_insensitive_);
         if (current_) {
+            enterShape(&internal::TypeKey<T>::id);
             internal::serializeWrapper(*this, value);
+            leaveShape();
             if (has_value) *has_value = true;
         }
         current_ = parent;
@@ -119,20 +140,47 @@ private:
 
     template <typename T>
     void decodeValue(const char* name, std::vector<T>& value, bool* has_value) {
-        const GenericNode* parent = current_;
+        decodeItems<T>(name, value, has_value);
+    }
+
+    template <typename T, size_t N>
+    void decodeValue(const char* name, SmallVector<T, N>& value, bool* has_value) {
+        decodeItems<T>(name, value, has_value);
+    }
+
+    template <typename T, size_t N>
+    void decodeValue(const char* name, T (&value)[N], bool* has_value) {
+        decodeItems<T>(name, value, has_value);
+    }
+
+#if __cplusplus >= 201103L
+    template <typename T, size_t N>
+    void decodeValue(const char* name, std::array<T, N>& value, bool* has_value) {
+        decodeItems<T>(name, value, has_value);
+    }
+#endif
+
+    template <typename T, typename S>
+    void decodeItems(const char* name, S& value, bool* has_value) {
+        const TapeNode* parent = current_;
         current_ = JSONDecoder::getObjectItem(current_, name, case_insensitive_);
         if (current_) {
-            uint32_t size = JSONDecoder::getObjectSize(current_);
+            size_t size = JSONDecoder::getObjectSize(current_);
             if (size) {
-                value.resize(size);
+                size = internal::resizeItems(value, size);
             }
-            const GenericNode* parent_temp = current_;
-            current_ = JSONDecoder::getChild(current_);
-            for (uint32_t idx = 0; current_ && (idx < size);
-                 (current_ = JSONDecoder::getNext(current_)), ++idx) {
-                decodeValue(NULL, *(typename internal::TypeTraits<T>::Type*)(&value.at(idx)), NULL);
+            if (threads_ > 1 && size >= PARALLEL_ITEMS) {
+                decodeRanges<T>(value, size);
+            } else {
+                const TapeNode* parent_temp = current_;
+                current_ = JSONDecoder::getChild(current_);
+                for (size_t idx = 0; current_ && (idx < size);
+                     (current_ = JSONDecoder::getNext(current_)), ++idx) {
+                    decodeValue(NULL, *(typename internal::TypeTraits<T>::Type*)(&value[idx]),
+                                NULL);
+                }
+                current_ = parent_temp;
             }
-            current_ = parent_temp;
             if (has_value) {
                 *has_value = true;
             }
@@ -140,20 +188,119 @@ private:
         current_ = parent;
     }
 
+    template <typename S>
+    struct Ranges {
+        JSONDecoder* const* workers;
+        S* value;
+        size_t size;
+        size_t count;
+        const TapeNode** starts;// first item of each range
+        size_t* failed;         // the first item of a range that set an error, size if none did
+        std::string* errors;
+    };
+
+    // each worker decodes its ranges with a decoder of its own over the same tape
+    template <typename T, typename S>
+    static void decodeRange(void* context, uint32_t worker, size_t idx) {
+        const Ranges<S>& ranges = *static_cast<const Ranges<S>*>(context);
+        JSONDecoder& decoder = *ranges.workers[worker];
+        decoder.clearError();
+        const size_t end = (idx + 1) * ranges.size / ranges.count;
+        size_t item = idx * ranges.size / ranges.count;
+        for (decoder.current_ = ranges.starts[idx]; decoder.current_ && (item < end);
+             (decoder.current_ = JSONDecoder::getNext(decoder.current_)), ++item) {
+            decoder.decodeValue(
+                NULL, *(typename internal::TypeTraits<T>::Type*)(&(*ranges.value)[item]), NULL);
+            if (ranges.failed[idx] == ranges.size && decoder.getError()) {
+                ranges.failed[idx] = item;
+                ranges.errors[idx] = decoder.getError();
+            }
+        }
+    }
+
+    // the size items of the array at current_, resized to hold them already
+    template <typename T, typename S>
+    void decodeRanges(S& value, size_t size) {
+        size_t count = size / RANGE_ITEMS;
+        if (count > (size_t)threads_ * RANGES_PER_THREAD) {
+            count = (size_t)threads_ * RANGES_PER_THREAD;
+        }
+        std::vector<const TapeNode*> starts(count, (const TapeNode*)NULL);
+        const TapeNode* item = JSONDecoder::getChild(current_);
+        for (size_t idx = 0, range = 0; item && (range < count);
+             (item = JSONDecoder::getNext(item)), ++idx) {
+            if (idx == range * size / count) {
+                starts[range++] = item;
+            }
+        }
+        std::vector<size_t> failed(count, size);
+        std::vector<std::string> errors(count);
+        const Ranges<S> ranges = {getWorkers(), &value,      size,       count,
+                                  &starts[0],   &failed[0], &errors[0]};
+        internal::parallelFor(count, threads_, &decodeRange<T, S>, (void*)&ranges);
+        for (size_t idx = 0; idx < count; ++idx) {
+            if (failed[idx] != size) {
+                setItemError(errors[idx].c_str(), failed[idx]);
+                break;
+            }
+        }
+    }
+
     template <typename K, typename V>
     void decodeValue(const char* name, std::map<K, V>& value, bool* has_value) {
-        const GenericNode* parent = current_;
+        decodeMap(name, value, has_value);
+    }
+
+    template <typename K, typename V>
+    void decodeValue(const char* name, FlatMap<K, V>& value, bool* has_value) {
+        decodeMap(name, value, has_value);
+    }
+
+#if __cplusplus >= 201103L
+    template <typename K, typename V>
+    void decodeValue(const char* name, std::unordered_map<K, V>& value, bool* has_value) {
+        decodeMap(name, value, has_value);
+    }
+#endif
+
+    template <typename T>
+    bool decodeRoot(T& value) {
+        if (!current_) {
+            return false;
+        }
+        const TapeNode* parent = current_;
+        // a nameless lookup yields current_ itself
+        decodeValue(NULL, value, NULL);
+
+        if (parent != current_) {
+            return false;
+        }
+        if (getError()) {
+            return false;
+        }
+        return true;
+    }
+
+    template <typename M>
+    void decodeMap(const char* name, M& value, bool* has_value) {
+        typedef typename M::key_type K;
+        typedef typename M::mapped_type V;
+        const TapeNode* parent = current_;
         current_ = JSONDecoder::getObjectItem(current_, name, case_insensitive_);
         if (current_) {
             value.clear();
+            internal::reserveItems(value, JSONDecoder::getObjectSize(current_));
 
-            const GenericNode* parent_temp = current_;
+            const TapeNode* parent_temp = current_;
             for (current_ = JSONDecoder::getChild(current_); current_;
                  current_ = JSONDecoder::getNext(current_)) {
-                std::string key(JSONDecoder::getKey(current_), JSONDecoder::getKeySize(current_));
-                V item = V();
-                decodeValue(NULL, *((typename internal::TypeTraits<V>::Type*)(&item)), NULL);
-                value.insert(std::pair<K, V>(internal::STOT::type<K>::strto(key.c_str()), item));
+                // keys are converted where they lie in the input
+                V* item = internal::insertItem(value, internal::STOT::type<K>::parse(
+                                                          JSONDecoder::getKey(current_),
+                                                          JSONDecoder::getKeySize(current_)));
+                if (item) {
+                    decodeValue(NULL, *((typename internal::TypeTraits<V>::Type*)item), NULL);
+                }
             }
             current_ = parent_temp;
             if (has_value) {
@@ -171,18 +318,40 @@ private:
     void decodeValue(const char* name, float& value, bool* has_value);
     void decodeValue(const char* name, double& value, bool* has_value);
     void decodeValue(const char* name, std::string& value, bool* has_value);
+    void decodeValue(const char* name, StringRef& value, bool* has_value);
     void decodeValue(const char* name, std::vector<bool>& value, bool* has_value);
-    bool checkItemType(const GenericNode& item, const int type) const;
-    bool item2Bool(const GenericNode& item) const;
+    // arrays of numbers are converted in one loop over the tape
+    void decodeValue(const char* name, std::vector<uint32_t>& value, bool* has_value);
+    void decodeValue(const char* name, std::vector<int32_t>& value, bool* has_value);
+    void decodeValue(const char* name, std::vector<uint64_t>& value, bool* has_value);
+    void decodeValue(const char* name, std::vector<int64_t>& value, bool* has_value);
+    void decodeValue(const char* name, std::vector<float>& value, bool* has_value);
+    void decodeValue(const char* name, std::vector<double>& value, bool* has_value);
+    template <typename T>
+    void decodeNumbers(const char* name, std::vector<T>& value, bool* has_value);
+    bool checkItemType(const TapeNode& item, const int type) const;
+    bool item2Bool(const TapeNode& item) const;
+
+    // a decoder per thread attached to this document, flags copied
+    JSONDecoder* const* getWorkers();
+    void clearError();
+    // the first error of a parallel decode, at item idx
+    void setItemError(const char* error, size_t idx);
+
+    // the fields of type are read from current_ until leaveShape
+    void enterShape(const void* type);
+    void leaveShape();
 
     // for value
-    static uint32_t getObjectSize(const GenericNode* parent);
-    static const GenericNode* getObjectItem(const GenericNode* parent, const char* name,
-                                            bool case_insensitive);
-    static const GenericNode* getChild(const GenericNode* parent);
-    static const GenericNode* getNext(const GenericNode* parent);
-    static const char* getKey(const GenericNode* parent);
-    static uint32_t getKeySize(const GenericNode* parent);
+    static uint32_t getObjectSize(const TapeNode* parent);
+    const TapeNode* getObjectItem(const TapeNode* parent, const char* name,
+                                  bool case_insensitive) const;
+    static const TapeNode* getChild(const TapeNode* parent);
+    static const TapeNode* getNext(const TapeNode* parent);
+    const char* getKey(const TapeNode* parent) const;
+    static uint32_t getKeySize(const TapeNode* parent);
+    // source text of a scalar node
+    const char* getValue(const TapeNode& item) const;
 };
 
 }// namespace serialflex
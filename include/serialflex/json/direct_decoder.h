@@ -0,0 +1,266 @@
+#ifndef __JSON_DIRECT_DECODER_H__
+#define __JSON_DIRECT_DECODER_H__
+
+#include <map>
+#include <string.h>
+#include <serialflex/field.h>
+#include <serialflex/traits.h>
+
+namespace serialflex {
+
+namespace json {
+class DirectReader;
+}// namespace json
+
+// Decodes JSON straight into the convert() targets in one pass over the input, without
+// building a document. The first object of each type runs serialize() to record where its
+// fields live; keys are then dispatched in input order and unknown values are skipped.
+// serialize() must convert the same members every time and must not depend on the values it
+// reads. Results match JSONDecoder otherwise.
+//
+//   JSONDirectDecoder decoder;
+//   bool result = decoder.reset(buf, len) && (decoder >> data);
+class EXPORTAPI JSONDirectDecoder {
+    typedef bool (*ReadTarget)(JSONDirectDecoder& decoder, void* value);
+    // one convert() call, value and has_value are addresses while serialize() runs and
+    // offsets into the object once they are part of a layout
+    struct Target {
+        const char* name;
+        uint32_t name_size;
+        bool has;// has_value is set
+        uintptr_t value;
+        uintptr_t has_value;
+        ReadTarget read;
+    };
+    struct Layout {
+        uint32_t first;// targets in layouts_
+        uint32_t count;
+        bool relative;// false when a field lies outside the object, serialize() runs each time
+    };
+
+    bool convert_by_type_; // convert by field type
+    bool case_insensitive_;// key case insensitive
+    bool padded_;          // INPUT_PADDING zero bytes follow length-delimited input
+    json::DirectReader* reader_;
+    std::vector<Target> targets_;// collected by serialize() and not part of a layout
+    std::vector<Target> layouts_;
+    std::map<const void*, Layout> types_;
+    std::vector<uint8_t> bound_;// keys already read in the objects being decoded
+
+    JSONDirectDecoder(const JSONDirectDecoder&);
+    JSONDirectDecoder& operator=(const JSONDirectDecoder&);
+
+public:
+    JSONDirectDecoder();
+    JSONDirectDecoder(const char* str, bool case_insensitive = false);
+    // data needs no '\0' terminator
+    JSONDirectDecoder(const char* data, size_t len, bool case_insensitive = false);
+    ~JSONDirectDecoder();
+
+    // the input must stay valid while it is decoded, every operator>> reads it from the start
+    bool reset(const char* str);
+    bool reset(const char* data, size_t len);
+    // length-delimited input is followed by INPUT_PADDING readable zero bytes
+    JSONDirectDecoder& setPadded(bool padded);
+    // key case insensitive
+    JSONDirectDecoder& setCaseInsensitive(bool case_insensitive);
+
+    // convert by field type
+    JSONDirectDecoder& setConvertByType(bool convert_by_type);
+
+    const char* getError() const;
+
+    template <typename T>
+    JSONDirectDecoder& operator&(const Field<T>& field) {
+        Field<T>& remove_const_field = *const_cast<Field<T>*>(&field);
+        return convert(field.getName(), remove_const_field.value(), remove_const_field.has());
+    }
+
+    // collects a field of the object being read
+    template <typename T>
+    JSONDirectDecoder& convert(const char* name, T& value, bool* has_value = NULL) {
+        typedef typename internal::TypeTraits<T>::Type Type;
+        // inline so that the length of a literal name folds to a constant
+        const Target target = {name,
+                               (uint32_t)strlen(name),
+                               has_value != NULL,
+                               (uintptr_t)&value,
+                               (uintptr_t)has_value,
+                               &JSONDirectDecoder::readTarget<Type>};
+        targets_.push_back(target);
+        return *this;
+    }
+
+    template <typename T>
+    bool operator>>(T& value) {
+        if (!begin()) {
+            return false;
+        }
+        readValue(value);
+        return (getError() == NULL);
+    }
+
+private:
+    template <typename T>
+    static bool readTarget(JSONDirectDecoder& decoder, void* value) {
+        return decoder.readValue(*(T*)value);
+    }
+
+    template <typename T>
+    bool readValue(T& value) {
+        const void* type = &internal::TypeKey<T>::id;
+        const Layout* layout = findLayout(type);
+        const size_t first = targets_.size();
+        if (!layout || !layout->relative) {
+            internal::serializeWrapper(*this, value);
+        }
+        readObject(type, layout, first, (uintptr_t)&value, sizeof(T));
+        return true;
+    }
+
+    template <typename T>
+    bool readValue(std::vector<T>& value) {
+        return readItems<T>(value);
+    }
+
+    template <typename T, size_t N>
+    bool readValue(SmallVector<T, N>& value) {
+        return readItems<T>(value);
+    }
+
+    template <typename T, size_t N>
+    bool readValue(T (&value)[N]) {
+        return readItems<T>(value, N);
+    }
+
+#if __cplusplus >= 201103L
+    template <typename T, size_t N>
+    bool readValue(std::array<T, N>& value) {
+        return readItems<T>(value.data(), N);
+    }
+#endif
+
+    template <typename T, typename S>
+    bool readItems(S& value) {
+        bool object = false;
+        if (!enterItems(object)) {
+            return true;
+        }
+        const size_t size = value.size();
+        if (!value.capacity()) {
+            // the length is not known up front, skip the smallest reallocations
+            value.reserve(sizeof(T) < 64 ? 64 / sizeof(T) : 1);
+        }
+        size_t idx = 0;
+        const char* key = NULL;
+        uint32_t key_size = 0;
+        for (; nextItem(object, key, key_size); ++idx) {
+            if (idx >= size) {
+                value.push_back(T());
+            }
+            readValue(*(typename internal::TypeTraits<T>::Type*)(&value[idx]));
+        }
+        if (idx) {
+            value.resize(idx);
+        }
+        return true;
+    }
+
+    // fixed arrays take the first capacity items and skip the rest
+    template <typename T>
+    bool readItems(T* value, size_t capacity) {
+        bool object = false;
+        if (!enterItems(object)) {
+            return true;
+        }
+        size_t idx = 0;
+        const char* key = NULL;
+        uint32_t key_size = 0;
+        for (; nextItem(object, key, key_size); ++idx) {
+            if (idx < capacity) {
+                readValue(*(typename internal::TypeTraits<T>::Type*)(&value[idx]));
+            } else {
+                skipItem();
+            }
+        }
+        if (idx) {
+            internal::resizeItems(value, capacity, idx);
+        }
+        return true;
+    }
+
+    template <typename K, typename V>
+    bool readValue(std::map<K, V>& value) {
+        return readMap(value);
+    }
+
+    template <typename K, typename V>
+    bool readValue(FlatMap<K, V>& value) {
+        return readMap(value);
+    }
+
+#if __cplusplus >= 201103L
+    template <typename K, typename V>
+    bool readValue(std::unordered_map<K, V>& value) {
+        return readMap(value);
+    }
+#endif
+
+    template <typename M>
+    bool readMap(M& value) {
+        typedef typename M::key_type K;
+        typedef typename M::mapped_type V;
+        value.clear();
+        bool object = false;
+        if (!enterItems(object)) {
+            return true;
+        }
+        const char* key = NULL;
+        uint32_t key_size = 0;
+        while (nextItem(object, key, key_size)) {
+            V* item = internal::insertItem(value, internal::STOT::type<K>::parse(key, key_size));
+            if (item) {
+                readValue(*(typename internal::TypeTraits<V>::Type*)item);
+            } else {
+                skipItem();
+            }
+        }
+        return true;
+    }
+
+    bool readValue(bool& value);
+    bool readValue(uint32_t& value);
+    bool readValue(int32_t& value);
+    bool readValue(uint64_t& value);
+    bool readValue(int64_t& value);
+    bool readValue(float& value);
+    bool readValue(double& value);
+    bool readValue(std::string& value);
+    bool readValue(StringRef& value);
+    bool readValue(std::vector<bool>& value);
+
+    bool begin();
+    const Layout* findLayout(const void* type) const;
+    // the object at the cursor, serialize() has appended its targets from first on unless the
+    // layout of the type is known already
+    void readObject(const void* type, const Layout* layout, size_t first, uintptr_t base,
+                    size_t size);
+    // dispatches the keys of the object at the cursor to targets[first, first + count)
+    void readFields(const std::vector<Target>& targets, size_t first, size_t count,
+                    uintptr_t base);
+    static size_t findTarget(const std::vector<Target>& targets, size_t first, size_t count,
+                             size_t hint, const uint8_t* bound, const char* key,
+                             uint32_t key_size, bool case_insensitive);
+    // steps into the array or object at the cursor, skips anything else
+    bool enterItems(bool& object);
+    // next element of the array, or next value of the object and its key
+    bool nextItem(bool object, const char*& key, uint32_t& key_size);
+    // consumes the value of a repeated map key or past the end of a fixed array
+    void skipItem();
+    // the scalar at the cursor when its type converts to type, skips anything else
+    bool readScalar(int32_t type, int32_t& item_type, const char*& value, uint32_t& size);
+};
+
+}// namespace serialflex
+
+#endif
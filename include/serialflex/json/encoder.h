@@ -3,6 +3,9 @@
 
 #include <map>
 #include <serialflex/field.h>
+#include <serialflex/parallel.h>
+#include <serialflex/sink.h>
+#include <serialflex/size_estimate.h>
 #include <serialflex/traits.h>
 
 namespace serialflex {
@@ -13,11 +16,26 @@ class Writer;
 
 class EXPORTAPI JSONEncoder {
     json::Writer* writer_;
+    bool formatted_;
+    bool presize_;    // large documents are counted first and the sink told their length
+    uint32_t threads_;// for the items of root sequences
 
 public:
     explicit JSONEncoder(std::string& str, bool formatted = false);
+    // the document goes out through sink, which is flushed after each operator<<
+    explicit JSONEncoder(OutputSink& sink, bool formatted = false);
     ~JSONEncoder();
 
+    // Root sequences of PARALLEL_ITEMS items or more are encoded by up to threads threads, in
+    // chunks written to strings of their own and then to the output in order; the output is
+    // the same as with one thread, and it is held twice in memory meanwhile. 1 by default.
+    void setThreads(uint32_t threads) { threads_ = threads; }
+
+    // Documents estimated at PRESIZE_BYTES or more are written once into a CountingSink first
+    // and the exact length is passed to the sink, a string is then allocated once and without
+    // spare capacity. The extra pass makes encoding slower, off by default.
+    void setPresize(bool presize) { presize_ = presize; }
+
     template <typename T>
     JSONEncoder& operator&(const Field<T>& field) {
         return convert(field.getName(), field.getValue(), field.has());
@@ -33,6 +51,7 @@ public:
 
     template <typename T>
     bool operator<<(const T& value) {
+        presize(value);
         startObject(NULL);
         const typename internal::TypeTraits<T>::Type& tratis_value =
             *(const typename internal::TypeTraits<T>::Type*)&value;
@@ -44,36 +63,76 @@ public:
 
     template <typename T>
     bool operator<<(const std::vector<T>& value) {
+        return encodeRoot(value, value.empty() ? NULL : &value[0], value.size());
+    }
+
+    bool operator<<(const std::vector<bool>& value) {
+        presize(value);
         if (value.empty()) {
             return false;
         }
-        startArray(NULL);
-        int32_t size = (int32_t)value.size();
-        for (int32_t i = 0; i < size; ++i) {
-            encodeValue(NULL, *(const typename internal::TypeTraits<T>::Type*)(&value.at(i)));
-        }
-        endArray();
+        encodeValue(NULL, value);
         return writerResult();
     }
 
+    template <typename T, size_t N>
+    bool operator<<(const SmallVector<T, N>& value) {
+        return encodeRoot(value, value.data(), value.size());
+    }
+
+    template <typename T, size_t N>
+    bool operator<<(const T (&value)[N]) {
+        return encodeRoot(value, value, N);
+    }
+
+#if __cplusplus >= 201103L
+    template <typename T, size_t N>
+    bool operator<<(const std::array<T, N>& value) {
+        return encodeRoot(value, value.data(), N);
+    }
+#endif
+
     template <typename K, typename V>
     bool operator<<(const std::map<K, V>& value) {
-        if (value.empty()) {
-            return false;
+        presize(value);
+        return encodeRoot(value);
+    }
+
+    template <typename K, typename V>
+    bool operator<<(const FlatMap<K, V>& value) {
+        presize(value);
+        return encodeRoot(value);
+    }
+
+#if __cplusplus >= 201103L
+    template <typename K, typename V>
+    bool operator<<(const std::unordered_map<K, V>& value) {
+        presize(value);
+        return encodeRoot(value);
+    }
+#endif
+
+    enum { PARALLEL_ITEMS = 1024, PRESIZE_BYTES = 4 * 1024 * 1024 };
+
+private:
+    enum { CHUNK_ITEMS = 256, CHUNKS_PER_THREAD = 8 };
+
+    template <typename T>
+    void presize(const T& value) {
+        if (!presize_) {
+            return;
         }
-        startObject(NULL);
-        for (typename std::map<K, V>::const_iterator it = value.begin(); it != value.end(); ++it) {
-            const typename internal::TypeTraits<K>::Type& key =
-                *(const typename internal::TypeTraits<K>::Type*)(&it->first);
-            const typename internal::TypeTraits<V>::Type& item =
-                *(const typename internal::TypeTraits<V>::Type*)(&it->second);
-            convert(internal::STOT::type<K>::tostr(key).c_str(), item);
+        SizeEstimate estimate(1, 4);
+        estimate.add(value);
+        if (estimate.size() < PRESIZE_BYTES) {
+            return;
         }
-        endObject();
-        return writerResult();
+        CountingSink counter;
+        JSONEncoder sizer(counter, formatted_);
+        sizer << value;
+        writerExpect(counter.size());
     }
 
-private:
     template <typename T>
     void encodeValue(const char* name, const T& value) {
         startObject(name);
@@ -86,26 +145,146 @@ private:
 
     template <typename T>
     void encodeValue(const char* name, const std::vector<T>& value) {
+        encodeItems(name, value.empty() ? NULL : &value[0], value.size());
+    }
+
+    template <typename T, size_t N>
+    void encodeValue(const char* name, const SmallVector<T, N>& value) {
+        encodeItems(name, value.data(), value.size());
+    }
+
+    template <typename T, size_t N>
+    void encodeValue(const char* name, const T (&value)[N]) {
+        encodeItems(name, value, N);
+    }
+
+#if __cplusplus >= 201103L
+    template <typename T, size_t N>
+    void encodeValue(const char* name, const std::array<T, N>& value) {
+        encodeItems(name, value.data(), N);
+    }
+#endif
+
+    template <typename S, typename T>
+    bool encodeRoot(const S& sequence, const T* value, size_t size) {
+        if (threads_ > 1 && size >= PARALLEL_ITEMS) {
+            encodeChunks(value, size);
+            return writerResult();
+        }
+        presize(sequence);
+        if (!size) {
+            return false;
+        }
+        encodeItems(NULL, value, size);
+        return writerResult();
+    }
+
+    template <typename T>
+    struct Chunks {
+        const T* value;
+        size_t size;
+        size_t count;
+        bool formatted;
+        std::string* pieces;
+        size_t* starts;// where the bytes of a piece begin that belong to the document
+    };
+
+    // Chunk idx is written the way the whole array would be, the chunks before it cut off:
+    // after the opening bracket it writes the item before its own and starts its piece behind
+    // that, at the separator of its first item. The last chunk closes the array.
+    template <typename T>
+    static void encodeChunk(void* context, uint32_t worker, size_t idx) {
+        (void)worker;
+        const Chunks<T>& chunks = *static_cast<const Chunks<T>*>(context);
+        const size_t begin = idx * chunks.size / chunks.count;
+        const size_t end = (idx + 1) * chunks.size / chunks.count;
+        JSONEncoder encoder(chunks.pieces[idx], chunks.formatted);
+        encoder.startArray(NULL);
+        if (idx) {
+            encoder.encodeValue(NULL, *(const typename internal::TypeTraits<T>::Type*)(
+                                          &chunks.value[begin - 1]));
+            chunks.starts[idx] = encoder.writerSize();
+        }
+        for (size_t i = begin; i < end; ++i) {
+            if (i) {
+                encoder.writerSeparation();
+            }
+            encoder.encodeValue(NULL,
+                                *(const typename internal::TypeTraits<T>::Type*)(&chunks.value[i]));
+        }
+        if (end == chunks.size) {
+            encoder.endArray();
+        }
+    }
+
+    template <typename T>
+    void encodeChunks(const T* value, size_t size) {
+        size_t count = size / CHUNK_ITEMS;
+        if (count > (size_t)threads_ * CHUNKS_PER_THREAD) {
+            count = (size_t)threads_ * CHUNKS_PER_THREAD;
+        }
+        std::vector<std::string> pieces(count);
+        std::vector<size_t> starts(count, 0);
+        const Chunks<T> chunks = {value, size, count, formatted_, &pieces[0], &starts[0]};
+        internal::parallelFor(count, threads_, &encodeChunk<T>, (void*)&chunks);
+        size_t length = 0;
+        for (size_t idx = 0; idx < count; ++idx) {
+            length += pieces[idx].size() - starts[idx];
+        }
+        writerExpect(length);
+        for (size_t idx = 0; idx < count; ++idx) {
+            writerWrite(pieces[idx].data() + starts[idx], pieces[idx].size() - starts[idx]);
+            std::string().swap(pieces[idx]);
+        }
+    }
+
+    template <typename T>
+    void encodeItems(const char* name, const T* value, size_t size) {
         startArray(name);
-        int32_t size = (int32_t)value.size();
-        for (int32_t i = 0; i < size; ++i) {
+        for (size_t i = 0; i < size; ++i) {
             if (i) {
                 writerSeparation();
             }
-            encodeValue(NULL, *(const typename internal::TypeTraits<T>::Type*)(&value.at(i)));
+            encodeValue(NULL, *(const typename internal::TypeTraits<T>::Type*)(&value[i]));
         }
         endArray();
     }
 
     template <typename K, typename V>
     void encodeValue(const char* name, const std::map<K, V>& value) {
+        encodeMap(name, value);
+    }
+
+    template <typename K, typename V>
+    void encodeValue(const char* name, const FlatMap<K, V>& value) {
+        encodeMap(name, value);
+    }
+
+#if __cplusplus >= 201103L
+    template <typename K, typename V>
+    void encodeValue(const char* name, const std::unordered_map<K, V>& value) {
+        encodeMap(name, value);
+    }
+#endif
+
+    template <typename M>
+    bool encodeRoot(const M& value) {
+        if (value.empty()) {
+            return false;
+        }
+        encodeMap(NULL, value);
+        return writerResult();
+    }
+
+    // one member per entry, keyed by the text of the map key
+    template <typename M>
+    void encodeMap(const char* name, const M& value) {
+        typedef typename internal::TypeTraits<typename M::key_type>::Type Key;
+        typedef typename internal::TypeTraits<typename M::mapped_type>::Type Item;
         startObject(name);
-        for (typename std::map<K, V>::const_iterator it = value.begin(); it != value.end(); ++it) {
-            const typename internal::TypeTraits<K>::Type& key =
-                *(const typename internal::TypeTraits<K>::Type*)(&it->first);
-            const typename internal::TypeTraits<V>::Type& item =
-                *(const typename internal::TypeTraits<V>::Type*)(&it->second);
-            convert(internal::STOT::type<K>::tostr(key).c_str(), item);
+        for (typename M::const_iterator it = value.begin(); it != value.end(); ++it) {
+            const internal::STOT::KeyText<Key> key(*(const Key*)(&it->first));
+            convert(key.c_str(), *(const Item*)(&it->second));
         }
         endObject();
     }
@@ -118,6 +297,7 @@ private:
     void encodeValue(const char* name, const float& value);
     void encodeValue(const char* name, const double& value);
     void encodeValue(const char* name, const std::string& value);
+    void encodeValue(const char* name, const StringRef& value);
     void encodeValue(const char* name, const std::vector<bool>& value);
     //
     void startObject(const char* name);
@@ -127,7 +307,10 @@ private:
 
     // for Writer
     bool writerResult() const;
+    void writerExpect(size_t size);
     void writerSeparation();
+    size_t writerSize() const;
+    void writerWrite(const char* data, size_t size);
 };
 
 }// namespace serialflex
@@ -0,0 +1,84 @@
+#ifndef __JSON_STREAM_DECODER_H__
+#define __JSON_STREAM_DECODER_H__
+
+#include <serialflex/json/decoder.h>
+
+namespace serialflex {
+
+namespace json {
+class StreamReader;
+}// namespace json
+
+// Decodes a JSON array (or a sequence of JSON values) that arrives in chunks. Every element
+// is decoded into a T and passed to handler(T&) as soon as it closes, so memory stays
+// bounded by the largest element rather than the whole document.
+//
+//   JSONStreamDecoder stream;
+//   while (size_t len = read(fd, buf, sizeof(buf)))
+//       if (!stream.feed<Item>(buf, len, handler)) break;
+//   stream.finish<Item>(handler);
+class EXPORTAPI JSONStreamDecoder {
+    json::StreamReader* reader_;
+    JSONDecoder decoder_;
+
+    JSONStreamDecoder(const JSONStreamDecoder&);
+    JSONStreamDecoder& operator=(const JSONStreamDecoder&);
+
+public:
+    explicit JSONStreamDecoder(bool case_insensitive = false);
+    ~JSONStreamDecoder();
+
+    // start over with a new stream
+    void reset();
+    // convert by field type
+    JSONStreamDecoder& setConvertByType(bool convert_by_type);
+
+    const char* getError() const;
+
+    template <typename T, typename Handler>
+    bool feed(const char* chunk, size_t len, Handler& handler) {
+        beginChunk(chunk, len);
+        const char* element = NULL;
+        size_t size = 0;
+        while (nextElement(element, size)) {
+            if (!decodeElement<T>(element, size, handler)) {
+                return false;
+            }
+        }
+        return (getError() == NULL);
+    }
+
+    // end of stream, fails if the document is incomplete
+    template <typename T, typename Handler>
+    bool finish(Handler& handler) {
+        const char* element = NULL;
+        size_t size = 0;
+        if (finishElement(element, size)) {
+            if (!decodeElement<T>(element, size, handler)) {
+                return false;
+            }
+        }
+        return (getError() == NULL);
+    }
+
+private:
+    template <typename T, typename Handler>
+    bool decodeElement(const char* element, size_t size, Handler& handler) {
+        T value = T();
+        if (!decoder_.reset(element, size) || !(decoder_ >> value)) {
+            setDecodeError();
+            return false;
+        }
+        handler(value);
+        return true;
+    }
+
+    void beginChunk(const char* chunk, size_t len);
+    bool nextElement(const char*& element, size_t& size);
+    bool finishElement(const char*& element, size_t& size);
+    void setDecodeError();
+};
+
+}// namespace serialflex
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef __SERIALFLEX_PARALLEL_H__
+#define __SERIALFLEX_PARALLEL_H__
+
+#include <serialflex/traits.h>
+
+namespace serialflex {
+
+namespace internal {
+
+// worker is the thread running the job, below the threads given to parallelFor; no two jobs of
+// one worker run at the same time, so it may name state of its own
+typedef void (*ParallelJob)(void* context, uint32_t worker, size_t idx);
+
+// job(context, worker, idx) for each idx in [0, count) on up to threads threads, the calling one
+// among them as worker 0. Each thread takes the next index left until there is none, so uneven
+// jobs even out. Without C++11 threads, or when they cannot be started, the jobs run on the
+// calling thread.
+EXPORTAPI void parallelFor(size_t count, uint32_t threads, ParallelJob job, void* context);
+
+}// namespace internal
+
+}// namespace serialflex
+
+#endif
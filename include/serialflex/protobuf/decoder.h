@@ -13,14 +13,19 @@ class Reader;
 }// namespace protobuf
 class EXPORTAPI ProtobufDecoder {
     protobuf::Reader* reader_;
+    bool own_reader_;
 
     ProtobufDecoder(const ProtobufDecoder&);
     ProtobufDecoder& operator=(const ProtobufDecoder&);
 
 public:
+    ProtobufDecoder();
     ProtobufDecoder(const uint8_t* data, const uint32_t size);
     ~ProtobufDecoder();
 
+    // parse a new message, the node storage of the previous one is reused
+    bool reset(const uint8_t* data, const uint32_t size);
+
     const char* getError() const;
 
     template <typename T>
@@ -53,7 +58,47 @@ public:
 
     template <typename T>
     void readField(Field<std::vector<T> >& field) {
-        // repeated
+        readRepeated<T>(field);
+    }
+
+    template <typename T, size_t N>
+    void readField(Field<SmallVector<T, N> >& field) {
+        readRepeated<T>(field);
+    }
+
+    template <typename T, size_t N>
+    void readField(Field<T[N]>& field) {
+        readRepeated<T>(field);
+    }
+
+#if __cplusplus >= 201103L
+    template <typename T, size_t N>
+    void readField(Field<std::array<T, N> >& field) {
+        readRepeated<T>(field);
+    }
+#endif
+
+    template <typename K, typename V>
+    void readField(Field<std::map<K, V> >& field) {
+        readMap(field);
+    }
+
+    template <typename K, typename V>
+    void readField(Field<FlatMap<K, V> >& field) {
+        readMap(field);
+    }
+
+#if __cplusplus >= 201103L
+    template <typename K, typename V>
+    void readField(Field<std::unordered_map<K, V> >& field) {
+        readMap(field);
+    }
+#endif
+
+private:
+    // repeated, packed or not; fixed arrays take the leading elements
+    template <typename T, typename S>
+    void readRepeated(Field<S>& field) {
         const GenericNode* node = getNodeByNumber(field.getNumber());
         if (!node) {
             return;
@@ -62,29 +107,44 @@ public:
         if (wire_type != field.getWireType() && wire_type != protobuf::WIRETYPE_LENGTH_DELIMITED) {
             return;
         }
+        if (field.getWireType() != protobuf::WIRETYPE_LENGTH_DELIMITED) {
+            node = unpack(node, field.getWireType());
+        }
         field.setHas(true);
-        std::vector<T>& value = field.value();
-        value.clear();
+        S& value = field.value();
+        // every item starts from its default value
+        internal::resizeItems(value, 0);
+        size_t size = 0;
         for (const GenericNode* cur_node = node; cur_node; cur_node = getNextNode(cur_node)) {
-            T item = T();
-            readValue(*cur_node, *(typename internal::TypeTraits<T>::Type*)(&item),
+            ++size;
+        }
+        size = internal::resizeItems(value, size);
+        const GenericNode* cur_node = node;
+        for (size_t idx = 0; idx < size; ++idx, cur_node = getNextNode(cur_node)) {
+            readValue(*cur_node, *(typename internal::TypeTraits<T>::Type*)(&value[idx]),
                       field.getType());
-            value.push_back(item);
         }
     }
 
-    template <typename K, typename V>
-    void readField(Field<std::map<K, V> >& field) {
-        // map(repeated message)
+    // map(repeated message)
+    template <typename M>
+    void readMap(Field<M>& field) {
+        typedef typename M::key_type K;
+        typedef typename M::mapped_type V;
         const GenericNode* node = getNodeByNumber(field.getNumber());
         if (!node || getWireType(node) != protobuf::WIRETYPE_LENGTH_DELIMITED) {
             return;
         }
         field.setHas(true);
-        std::map<K, V>& value = field.value();
+        M& value = field.value();
         value.clear();
+        size_t size = 0;
+        for (const GenericNode* cur_node = node; cur_node; cur_node = getNextNode(cur_node)) {
+            ++size;
+        }
+        internal::reserveItems(value, size);
         for (const GenericNode* cur_node = node; cur_node; cur_node = getNextNode(cur_node)) {
-            ProtobufDecoder decoder(getData(cur_node), getDataSize(cur_node));
+            ProtobufDecoder decoder(*this, getData(cur_node), getDataSize(cur_node));
             const GenericNode* first_node = decoder.getNodeByNumber(1);
             const GenericNode* second_node = decoder.getNodeByNumber(2);
             if (!first_node || !second_node) {
@@ -92,20 +152,23 @@ public:
                 continue;
             }
             K key = K();
-            V item = V();
-            readValue(*first_node, *(typename internal::TypeTraits<K>::Type*)(&key),
-                      field.getType());
-            readValue(*second_node, *(typename internal::TypeTraits<V>::Type*)(&item),
-                      field.getType2());
-            value.insert(std::pair<K, V>(key, item));
+            decoder.readValue(*first_node, *(typename internal::TypeTraits<K>::Type*)(&key),
+                              field.getType());
+            V* item = internal::insertItem(value, key);
+            if (item) {
+                decoder.readValue(*second_node, *(typename internal::TypeTraits<V>::Type*)item,
+                                  field.getType2());
+            }
         }
     }
 
-private:
+    // nested messages borrow the parent's child reader instead of allocating one
+    ProtobufDecoder(ProtobufDecoder& parent, const uint8_t* data, const uint32_t size);
+
     template <typename T>
     void readValue(const GenericNode& node, T& value, const protobuf::FieldType field_type) {
         assert(field_type == protobuf::FIELDTYPE_MESSAGE);
-        ProtobufDecoder decoder(getData(&node), getDataSize(&node));
+        ProtobufDecoder decoder(*this, getData(&node), getDataSize(&node));
         decoder >> value;
     }
     void readValue(const GenericNode& node, int32_t& value, const protobuf::FieldType field_type);
@@ -116,8 +179,13 @@ private:
     void readValue(const GenericNode& node, double& value, const protobuf::FieldType field_type);
     void readValue(const GenericNode& node, std::string& value,
                    const protobuf::FieldType field_type);
+    // points into the message, protobuf stores strings verbatim
+    void readValue(const GenericNode& node, StringRef& value,
+                   const protobuf::FieldType field_type);
 
     const GenericNode* getNodeByNumber(const uint32_t field_number) const;
+    // the chain of node with every packed payload split into elements of wire_type
+    const GenericNode* unpack(const GenericNode* node, const protobuf::WireType wire_type);
     protobuf::WireType getWireType(const GenericNode* node);
     static const GenericNode* getNextNode(const GenericNode* node);
     static const uint8_t* getData(const GenericNode* node);
@@ -4,15 +4,23 @@
 #include <map>
 #include <serialflex/field.h>
 #include <serialflex/protobuf/writer.h>
+#include <serialflex/sink.h>
 #include <serialflex/traits.h>
 
 namespace serialflex {
 
 class EXPORTAPI ProtobufEncoder {
-    std::string& str_;
+    StringSink* string_sink_;// owned when writing into a string
+    OutputSink& sink_;
+
+    ProtobufEncoder(const ProtobufEncoder&);
+    ProtobufEncoder& operator=(const ProtobufEncoder&);
 
 public:
-    explicit ProtobufEncoder(std::string& str): str_(str) {}
+    explicit ProtobufEncoder(std::string& str);
+    // the message goes out through sink, which is flushed after each operator<<
+    explicit ProtobufEncoder(OutputSink& sink);
+    ~ProtobufEncoder();
 
     template <typename T>
     bool operator<<(const T& value) {
@@ -20,11 +28,12 @@ public:
         protobuf::MessageByteSize mb(capacity);
         internal::serializeWrapper(mb,
                                    *const_cast<typename internal::TypeTraits<T>::Type*>(&value));
-        str_.reserve(capacity);
+        sink_.expect(capacity);
 
+        const size_t start = sink_.size();
         internal::serializeWrapper(*this,
                                    *const_cast<typename internal::TypeTraits<T>::Type*>(&value));
-        return (!str_.empty());
+        return sink_.flush() && (sink_.size() != start);
     }
 
     template <typename T>
@@ -37,6 +46,7 @@ public:
 
 private:
     void writeField(const Field<std::string>& field);
+    void writeField(const Field<StringRef>& field);
 
     template <typename T>
     void writeField(const Field<T>& field) {
@@ -47,35 +57,55 @@ private:
 
     template <typename T>
     void writeField(const Field<std::vector<T> >& field) {
-        // repeated
-        const std::vector<T>& value = field.getValue();
-        if (value.empty()) {
+        writeRepeated<T>(field, field.getValue().size());
+    }
+
+    template <typename T, size_t N>
+    void writeField(const Field<SmallVector<T, N> >& field) {
+        writeRepeated<T>(field, field.getValue().size());
+    }
+
+    template <typename T, size_t N>
+    void writeField(const Field<T[N]>& field) {
+        writeRepeated<T>(field, N);
+    }
+
+#if __cplusplus >= 201103L
+    template <typename T, size_t N>
+    void writeField(const Field<std::array<T, N> >& field) {
+        writeRepeated<T>(field, N);
+    }
+#endif
+
+    // repeated
+    template <typename T, typename S>
+    void writeRepeated(const Field<S>& field, const size_t size) {
+        if (!size) {
             return;
         }
+        const S& value = field.getValue();
         const uint32_t field_number = field.getNumber();
         const protobuf::FieldType field_type = field.getType();
-        const uint32_t size = (uint32_t)value.size();
         if (field.getPacked()) {
             // tag - length - value - value ......
             writeTag(field_number, protobuf::WIRETYPE_LENGTH_DELIMITED);// tag
 
             uint64_t length = 0;
-            for (uint32_t idx = 0; idx < size; ++idx) {
-                const typename internal::TypeTraits<T>::Type& item = value.at(idx);
-                length += protobuf::MessageByteSize::varintSize(
-                    protobuf::MessageByteSize::valueSize(item, field_type));
+            for (size_t idx = 0; idx < size; ++idx) {
+                const typename internal::TypeTraits<T>::Type& item = value[idx];
+                length += protobuf::MessageByteSize::valueSize(item, field_type);
             }
             writeVarint(length);// length
 
-            for (uint32_t idx = 0; idx < size; ++idx) {
-                const typename internal::TypeTraits<T>::Type& item = value.at(idx);
+            for (size_t idx = 0; idx < size; ++idx) {
+                const typename internal::TypeTraits<T>::Type& item = value[idx];
                 writeValue(item, field_type);// value
             }
         } else {
             // tag - value | tag - value | tag - value | ......
             // string/bytes/message: tag - length - value | tag - length - value | ......
-            for (uint32_t idx = 0; idx < size; ++idx) {
-                const typename internal::TypeTraits<T>::Type& item = value.at(idx);
+            for (size_t idx = 0; idx < size; ++idx) {
+                const typename internal::TypeTraits<T>::Type& item = value[idx];
                 writeTag(field_number, field.getWireType());// tag
                 writeValue(item, field_type);               // value
             }
@@ -84,8 +114,27 @@ private:
 
     template <typename K, typename V>
     void writeField(const Field<std::map<K, V> >& field) {
-        // map(repeated message)
-        const std::map<K, V>& value = field.getValue();
+        writeMap(field);
+    }
+
+    template <typename K, typename V>
+    void writeField(const Field<FlatMap<K, V> >& field) {
+        writeMap(field);
+    }
+
+#if __cplusplus >= 201103L
+    template <typename K, typename V>
+    void writeField(const Field<std::unordered_map<K, V> >& field) {
+        writeMap(field);
+    }
+#endif
+
+    // map(repeated message), one entry message per element
+    template <typename M>
+    void writeMap(const Field<M>& field) {
+        typedef typename M::key_type K;
+        typedef typename M::mapped_type V;
+        const M& value = field.getValue();
         if (value.empty()) {
             return;
         }
@@ -93,7 +142,7 @@ private:
         const uint32_t field_number = field.getNumber();
         const protobuf::FieldType field_type = field.getType();
         const protobuf::FieldType field_type2 = field.getType2();
-        for (typename std::map<K, V>::const_iterator it = value.begin(); it != value.end(); ++it) {
+        for (typename M::const_iterator it = value.begin(); it != value.end(); ++it) {
             // 1.tag
             writeTag(field_number, protobuf::WIRETYPE_LENGTH_DELIMITED);
 
@@ -137,8 +186,9 @@ private:
         internal::serializeWrapper(mb,
                                    *const_cast<typename internal::TypeTraits<T>::Type*>(&value));
 
-        writeVarint(size);             // length
-        ProtobufEncoder(str_) << value;// value
+        writeVarint(size);// length
+        internal::serializeWrapper(*this,
+                                   *const_cast<typename internal::TypeTraits<T>::Type*>(&value));
     }
     void writeValue(const int32_t& value, const protobuf::FieldType field_type);
     void writeValue(const int64_t& value, const protobuf::FieldType field_type);
@@ -149,6 +199,7 @@ private:
     void writeValue(const double& value,
                     const protobuf::FieldType field_type = protobuf::FIELDTYPE_FIXED64);
     void writeValue(const std::string& value, const protobuf::FieldType field_type);
+    void writeValue(const StringRef& value, const protobuf::FieldType field_type);
 
     void writeTag(const uint32_t field_number, const protobuf::WireType wire_type);
     void writeVarint(const uint64_t value);
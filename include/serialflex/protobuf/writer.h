@@ -16,6 +16,7 @@ public:
     explicit MessageByteSize(uint32_t& size): size_(size) {}
 
     MessageByteSize& operator&(const Field<std::string>& field);
+    MessageByteSize& operator&(const Field<StringRef>& field);
 
     template <typename T>
     MessageByteSize& operator&(const Field<T>& field) {
@@ -41,6 +42,7 @@ public:
     static uint32_t valueSize(const float& value, const FieldType field_type = FIELDTYPE_FIXED32);
     static uint32_t valueSize(const double& value, const FieldType field_type = FIELDTYPE_FIXED64);
     static uint32_t valueSize(const std::string& value, const FieldType field_type);
+    static uint32_t valueSize(const StringRef& value, const FieldType field_type);
     static uint32_t varintSize(const uint64_t value);
     static uint32_t zigZagEncode(const int32_t value);
     static uint64_t zigZagEncode(const int64_t value);
@@ -62,30 +64,49 @@ private:
 
     template <typename T>
     void fieldSize(const Field<std::vector<T> >& field) {
-        // repeated
-        const std::vector<T>& value = field.getValue();
-        if (value.empty()) {
+        repeatedSize<T>(field, field.getValue().size());
+    }
+
+    template <typename T, size_t N>
+    void fieldSize(const Field<SmallVector<T, N> >& field) {
+        repeatedSize<T>(field, field.getValue().size());
+    }
+
+    template <typename T, size_t N>
+    void fieldSize(const Field<T[N]>& field) {
+        repeatedSize<T>(field, N);
+    }
+
+#if __cplusplus >= 201103L
+    template <typename T, size_t N>
+    void fieldSize(const Field<std::array<T, N> >& field) {
+        repeatedSize<T>(field, N);
+    }
+#endif
+
+    // repeated
+    template <typename T, typename S>
+    void repeatedSize(const Field<S>& field, const size_t size) {
+        if (!size) {
             return;
         }
+        const S& value = field.getValue();
         const uint32_t field_number = field.getNumber();
         const FieldType field_type = field.getType();
-        const uint32_t size = (uint32_t)value.size();
         if (field.getPacked()) {
             // tag - length - value - value ......
-            const uint64_t tag = (field_number << 3) | WIRETYPE_LENGTH_DELIMITED;
-            size_ += 0;
-            varintSize(tag);
+            size_ += varintSize((field_number << 3) | WIRETYPE_LENGTH_DELIMITED);// tag
             uint64_t length = 0;
-            for (uint32_t idx = 0; idx < size; ++idx) {
-                const typename internal::TypeTraits<T>::Type& traits_item = value.at(idx);
-                length += varintSize(valueSize(traits_item, field_type));
+            for (size_t idx = 0; idx < size; ++idx) {
+                const typename internal::TypeTraits<T>::Type& traits_item = value[idx];
+                length += valueSize(traits_item, field_type);
             }
             size_ += (varintSize(length) + length);
         } else {
             // tag - value | tag - value | tag - value | ......
             // string/bytes/message: tag - length - value | tag - length - value | ......
-            for (uint32_t idx = 0; idx < size; ++idx) {
-                const typename internal::TypeTraits<T>::Type& traits_item = value.at(idx);
+            for (size_t idx = 0; idx < size; ++idx) {
+                const typename internal::TypeTraits<T>::Type& traits_item = value[idx];
                 size_ += varintSize((field_number << 3) | field.getWireType());// tag
                 const uint64_t length = valueSize(traits_item, field_type);
                 if (field_type == FIELDTYPE_STRING || field_type == FIELDTYPE_MESSAGE ||
@@ -99,8 +120,27 @@ private:
 
     template <typename K, typename V>
     void fieldSize(const Field<std::map<K, V> >& field) {
-        // map(repeated message)
-        const std::map<K, V>& value = field.getValue();
+        mapSize(field);
+    }
+
+    template <typename K, typename V>
+    void fieldSize(const Field<FlatMap<K, V> >& field) {
+        mapSize(field);
+    }
+
+#if __cplusplus >= 201103L
+    template <typename K, typename V>
+    void fieldSize(const Field<std::unordered_map<K, V> >& field) {
+        mapSize(field);
+    }
+#endif
+
+    // map(repeated message)
+    template <typename M>
+    void mapSize(const Field<M>& field) {
+        typedef typename M::key_type K;
+        typedef typename M::mapped_type V;
+        const M& value = field.getValue();
         if (value.empty()) {
             return;
         }
@@ -108,7 +148,7 @@ private:
         const uint32_t field_number = field.getNumber();
         const FieldType field_type = field.getType();
         const FieldType field_type2 = field.getType2();
-        for (typename std::map<K, V>::const_iterator it = value.begin(); it != value.end(); ++it) {
+        for (typename M::const_iterator it = value.begin(); it != value.end(); ++it) {
             size_ += varintSize((field_number << 3) | WIRETYPE_LENGTH_DELIMITED);// tag
 
             const typename internal::TypeTraits<K>::Type& first = it->first;
@@ -0,0 +1,161 @@
+#ifndef __SERIALFLEX_SINK_H__
+#define __SERIALFLEX_SINK_H__
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <serialflex/traits.h>
+
+namespace serialflex {
+
+// Destination of the encoders. They write through a raw cursor into the window [cursor, end)
+// and ask reserve() for more when it runs short; sinks grow, pass on what they hold or fail
+// there. After a failure further writes are dropped and flush() returns false.
+class EXPORTAPI OutputSink {
+protected:
+    char* cursor_;
+    char* end_;
+    bool failed_;
+
+    OutputSink(const OutputSink&);
+    OutputSink& operator=(const OutputSink&);
+
+public:
+    OutputSink(): cursor_(NULL), end_(NULL), failed_(false) {}
+    virtual ~OutputSink() {}
+
+    // size writable bytes at cursor(), false when the sink cannot provide them
+    bool reserve(size_t size) {
+        if (room() >= size) {
+            return true;
+        }
+        if (!failed_ && (!makeRoom(size) || room() < size)) {
+            failed_ = true;
+        }
+        return !failed_;
+    }
+    char* cursor() { return cursor_; }
+    // writable bytes at cursor() without asking the sink
+    size_t room() const { return (size_t)(end_ - cursor_); }
+    // size bytes were written at cursor()
+    void advance(size_t size) { cursor_ += size; }
+
+    void put(char c) {
+        if (cursor_ != end_ || reserve(1)) {
+            *cursor_++ = c;
+        }
+    }
+    // in pieces when the window is smaller than size
+    void write(const char* data, size_t size);
+    void write(const char* str) { write(str, strlen(str)); }
+
+    bool failed() const { return failed_; }
+    // bytes written so far
+    virtual size_t size() const = 0;
+    // about size more bytes are coming, a hint only
+    virtual void expect(size_t size) { (void)size; }
+    // passes everything written on, false when the sink failed
+    virtual bool flush() { return !failed_; }
+
+protected:
+    // room at cursor_ for size bytes or as many as the sink holds, false when there is none
+    virtual bool makeRoom(size_t size) = 0;
+};
+
+// appends to a std::string, which holds unwritten bytes past the output until flush()
+class EXPORTAPI StringSink : public OutputSink {
+    std::string& str_;
+    size_t start_;  // where the open window started writing
+    size_t written_;// bytes written before it
+
+public:
+    explicit StringSink(std::string& str);
+    ~StringSink();
+
+    size_t size() const;
+    void expect(size_t size);
+    bool flush();
+
+protected:
+    bool makeRoom(size_t size);
+};
+
+// a caller buffer, writes past its end fail
+class EXPORTAPI BufferSink : public OutputSink {
+    char* buffer_;
+
+public:
+    BufferSink(char* buffer, size_t capacity);
+
+    const char* data() const { return buffer_; }
+    size_t size() const { return (size_t)(cursor_ - buffer_); }
+
+protected:
+    bool makeRoom(size_t size);
+};
+
+// keeps nothing and counts the bytes, the size of a document before it is written
+class EXPORTAPI CountingSink : public OutputSink {
+    enum { WINDOW_SIZE = 4096 };
+    char window_[WINDOW_SIZE];// written over again and again
+    size_t counted_;
+
+public:
+    CountingSink();
+
+    size_t size() const { return counted_ + (size_t)(cursor_ - window_); }
+
+protected:
+    bool makeRoom(size_t size);
+};
+
+// collects CHUNK_SIZE bytes and passes each full chunk on with drain()
+class EXPORTAPI ChunkSink : public OutputSink {
+public:
+    enum { CHUNK_SIZE = 16 * 1024 };
+
+private:
+    char chunk_[CHUNK_SIZE];
+    size_t drained_;
+
+public:
+    ChunkSink();
+
+    size_t size() const { return drained_ + (size_t)(cursor_ - chunk_); }
+    bool flush();
+
+protected:
+    bool makeRoom(size_t size);
+    // false on a write error
+    virtual bool drain(const char* data, size_t size) = 0;
+};
+
+// a FILE* opened for writing, flush() flushes it too
+class EXPORTAPI FileSink : public ChunkSink {
+    FILE* file_;
+
+public:
+    explicit FileSink(FILE* file): file_(file) {}
+    ~FileSink();
+
+    bool flush();
+
+protected:
+    bool drain(const char* data, size_t size);
+};
+
+// a file descriptor such as a socket, the descriptor stays open
+class EXPORTAPI FdSink : public ChunkSink {
+    int fd_;
+
+public:
+    explicit FdSink(int fd): fd_(fd) {}
+    ~FdSink();
+
+protected:
+    bool drain(const char* data, size_t size);
+};
+
+}// namespace serialflex
+
+#endif
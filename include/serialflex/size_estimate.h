@@ -0,0 +1,131 @@
+#ifndef __SERIALFLEX_SIZE_ESTIMATE_H__
+#define __SERIALFLEX_SIZE_ESTIMATE_H__
+
+#include <string.h>
+#include <map>
+#include <serialflex/field.h>
+#include <serialflex/traits.h>
+
+namespace serialflex {
+
+// Rough length of a text document, enough to tell a small one from a large one without writing
+// it. A field counts its name name_copies times plus field_bytes, scalars count NUMBER_BYTES
+// and strings their length. Sequences and maps count their first element as many times as
+// they have elements, so the walk visits one element per level however large the value is.
+class SizeEstimate {
+    size_t size_;
+    size_t name_copies_;
+    size_t field_bytes_;
+
+public:
+    enum { NUMBER_BYTES = 8 };
+
+    SizeEstimate(size_t name_copies, size_t field_bytes)
+        : size_(0), name_copies_(name_copies), field_bytes_(field_bytes) {}
+
+    size_t size() const { return size_; }
+
+    template <typename T>
+    SizeEstimate& operator&(const Field<T>& field) {
+        return convert(field.getName(), field.getValue(), field.has());
+    }
+
+    template <typename T>
+    SizeEstimate& convert(const char* name, const T& value, const bool* has_value = NULL) {
+        if (!has_value || (*has_value == true)) {
+            if (name) {
+                size_ += strlen(name) * name_copies_;
+            }
+            size_ += field_bytes_;
+            add(*(const typename internal::TypeTraits<T>::Type*)(&value));
+        }
+        return *this;
+    }
+
+    template <typename T>
+    void add(const T& value) {
+        const typename internal::TypeTraits<T>::Type& tratis_value =
+            *(const typename internal::TypeTraits<T>::Type*)&value;
+        internal::serializeWrapper(
+            *this, *const_cast<typename internal::TypeTraits<T>::Type*>(&tratis_value));
+    }
+    void add(const bool&) { size_ += 5; }
+    void add(const uint32_t&) { size_ += NUMBER_BYTES; }
+    void add(const int32_t&) { size_ += NUMBER_BYTES; }
+    void add(const uint64_t&) { size_ += NUMBER_BYTES; }
+    void add(const int64_t&) { size_ += NUMBER_BYTES; }
+    void add(const float&) { size_ += NUMBER_BYTES; }
+    void add(const double&) { size_ += NUMBER_BYTES; }
+    void add(const std::string& value) { size_ += value.size() + 2; }
+    void add(const StringRef& value) { size_ += value.size() + 2; }
+    void add(const std::vector<bool>& value) { size_ += value.size() * (5 + field_bytes_); }
+
+    template <typename T>
+    void add(const std::vector<T>& value) {
+        addItems(value.empty() ? NULL : &value[0], value.size());
+    }
+
+    template <typename T, size_t N>
+    void add(const SmallVector<T, N>& value) {
+        addItems(value.data(), value.size());
+    }
+
+    template <typename T, size_t N>
+    void add(const T (&value)[N]) {
+        addItems(value, N);
+    }
+
+#if __cplusplus >= 201103L
+    template <typename T, size_t N>
+    void add(const std::array<T, N>& value) {
+        addItems(value.data(), N);
+    }
+#endif
+
+    template <typename K, typename V>
+    void add(const std::map<K, V>& value) {
+        addEntries(value);
+    }
+
+    template <typename K, typename V>
+    void add(const FlatMap<K, V>& value) {
+        addEntries(value);
+    }
+
+#if __cplusplus >= 201103L
+    template <typename K, typename V>
+    void add(const std::unordered_map<K, V>& value) {
+        addEntries(value);
+    }
+#endif
+
+private:
+    template <typename T>
+    void addItems(const T* value, size_t size) {
+        if (!size) {
+            return;
+        }
+        SizeEstimate item(name_copies_, field_bytes_);
+        item.add(*(const typename internal::TypeTraits<T>::Type*)(&value[0]));
+        size_ += (item.size_ + field_bytes_) * size;
+    }
+
+    // the key is counted like a name
+    template <typename M>
+    void addEntries(const M& value) {
+        if (value.empty()) {
+            return;
+        }
+        typedef typename internal::TypeTraits<typename M::key_type>::Type Key;
+        typedef typename internal::TypeTraits<typename M::mapped_type>::Type Item;
+        SizeEstimate entry(name_copies_, field_bytes_);
+        entry.add(*(const Key*)(&value.begin()->first));
+        entry.size_ *= name_copies_;
+        entry.add(*(const Item*)(&value.begin()->second));
+        size_ += (entry.size_ + field_bytes_) * value.size();
+    }
+};
+
+}// namespace serialflex
+
+#endif
@@ -0,0 +1,198 @@
+#ifndef __SERIALFLEX_SMALL_VECTOR_H__
+#define __SERIALFLEX_SMALL_VECTOR_H__
+
+#include <stddef.h>
+#include <new>
+#if __cplusplus >= 201103L
+#include <utility>
+#endif
+
+namespace serialflex {
+
+// Sequence that keeps up to N elements inside the object and moves to the heap only when it
+// grows past them, serialized like std::vector. Small repeated fields such as coordinates or
+// colors then cost no allocation per instance.
+template <typename T, size_t N>
+class SmallVector {
+public:
+    typedef T value_type;
+    typedef T* iterator;
+    typedef const T* const_iterator;
+
+private:
+    // raw storage for the inline elements, the union aligns it for any scalar member of T
+    union Storage {
+        char bytes[N * sizeof(T)];
+        long double align_float;
+        long long align_int;
+        void* align_pointer;
+    };
+
+    T* data_;
+    size_t size_;
+    size_t capacity_;
+    Storage storage_;
+
+public:
+    SmallVector(): data_((T*)storage_.bytes), size_(0), capacity_(N) {}
+    explicit SmallVector(size_t size, const T& value = T())
+        : data_((T*)storage_.bytes), size_(0), capacity_(N) {
+        resize(size, value);
+    }
+    SmallVector(const SmallVector& other): data_((T*)storage_.bytes), size_(0), capacity_(N) {
+        reserve(other.size_);
+        for (; size_ < other.size_; ++size_) {
+            new (data_ + size_) T(other.data_[size_]);
+        }
+    }
+    SmallVector& operator=(const SmallVector& other) {
+        if (this != &other) {
+            clear();
+            reserve(other.size_);
+            for (; size_ < other.size_; ++size_) {
+                new (data_ + size_) T(other.data_[size_]);
+            }
+        }
+        return *this;
+    }
+#if __cplusplus >= 201103L
+    SmallVector(SmallVector&& other): data_((T*)storage_.bytes), size_(0), capacity_(N) {
+        takeFrom(other);
+    }
+    SmallVector& operator=(SmallVector&& other) {
+        if (this != &other) {
+            clear();
+            takeFrom(other);
+        }
+        return *this;
+    }
+#endif
+    ~SmallVector() {
+        clear();
+        if (!isInline()) {
+            ::operator delete(data_);
+        }
+    }
+
+    iterator begin() { return data_; }
+    iterator end() { return data_ + size_; }
+    const_iterator begin() const { return data_; }
+    const_iterator end() const { return data_ + size_; }
+    T* data() { return data_; }
+    const T* data() const { return data_; }
+    size_t size() const { return size_; }
+    size_t capacity() const { return capacity_; }
+    bool empty() const { return (size_ == 0); }
+    T& operator[](size_t idx) { return data_[idx]; }
+    const T& operator[](size_t idx) const { return data_[idx]; }
+    T& front() { return data_[0]; }
+    const T& front() const { return data_[0]; }
+    T& back() { return data_[size_ - 1]; }
+    const T& back() const { return data_[size_ - 1]; }
+
+    void push_back(const T& value) {
+        if (size_ == capacity_) {
+            // value may live in this vector, copy it before the elements move
+            const T item(value);
+            grow(size_ + 1);
+            new (data_ + size_) T(item);
+        } else {
+            new (data_ + size_) T(value);
+        }
+        ++size_;
+    }
+#if __cplusplus >= 201103L
+    template <typename... Args>
+    T& emplace_back(Args&&... args) {
+        if (size_ == capacity_) {
+            grow(size_ + 1);
+        }
+        new (data_ + size_) T(std::forward<Args>(args)...);
+        return data_[size_++];
+    }
+#endif
+    void pop_back() { data_[--size_].~T(); }
+    void clear() {
+        while (size_) {
+            data_[--size_].~T();
+        }
+    }
+    void reserve(size_t capacity) {
+        if (capacity > capacity_) {
+            grow(capacity);
+        }
+    }
+    void resize(size_t size, const T& value = T()) {
+        while (size_ > size) {
+            data_[--size_].~T();
+        }
+        reserve(size);
+        for (; size_ < size; ++size_) {
+            new (data_ + size_) T(value);
+        }
+    }
+
+    bool operator==(const SmallVector& other) const {
+        if (size_ != other.size_) {
+            return false;
+        }
+        for (size_t idx = 0; idx < size_; ++idx) {
+            if (!(data_[idx] == other.data_[idx])) {
+                return false;
+            }
+        }
+        return true;
+    }
+    bool operator!=(const SmallVector& other) const { return !(*this == other); }
+
+private:
+    bool isInline() const { return data_ == (const T*)storage_.bytes; }
+
+    // moves the elements to a heap block of at least capacity, doubling to keep appends linear
+    void grow(size_t capacity) {
+        if (capacity < capacity_ * 2) {
+            capacity = capacity_ * 2;
+        }
+        T* data = (T*)::operator new(capacity * sizeof(T));
+        for (size_t idx = 0; idx < size_; ++idx) {
+#if __cplusplus >= 201103L
+            new (data + idx) T(std::move(data_[idx]));
+#else
+            new (data + idx) T(data_[idx]);
+#endif
+            data_[idx].~T();
+        }
+        if (!isInline()) {
+            ::operator delete(data_);
+        }
+        data_ = data;
+        capacity_ = capacity;
+    }
+
+#if __cplusplus >= 201103L
+    // takes over the heap block of other, or moves its inline elements one by one
+    void takeFrom(SmallVector& other) {
+        if (!other.isInline()) {
+            if (!isInline()) {
+                ::operator delete(data_);
+            }
+            data_ = other.data_;
+            size_ = other.size_;
+            capacity_ = other.capacity_;
+            other.data_ = (T*)other.storage_.bytes;
+            other.size_ = 0;
+            other.capacity_ = N;
+            return;
+        }
+        reserve(other.size_);
+        for (; size_ < other.size_; ++size_) {
+            new (data_ + size_) T(std::move(other.data_[size_]));
+        }
+        other.clear();
+    }
+#endif
+};
+
+}// namespace serialflex
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef __SERIALFLEX_STRING_REF_H__
+#define __SERIALFLEX_STRING_REF_H__
+
+#include <stddef.h>
+#include <string.h>
+#include <string>
+
+namespace serialflex {
+
+// Non-owning text for decode-mostly fields, usable in serialize() like std::string. Decoders
+// point it straight into the input when the value is stored verbatim there and into their own
+// scratch storage when it had to be unescaped. Either way it stays valid while the input is
+// alive and until the decoder is reset, decodes again or is destroyed.
+class StringRef {
+    const char* data_;
+    size_t size_;
+
+public:
+    StringRef(): data_(""), size_(0) {}
+    StringRef(const char* data, size_t size): data_(data), size_(size) {}
+    StringRef(const char* str): data_(str), size_(strlen(str)) {}
+    StringRef(const std::string& str): data_(str.data()), size_(str.size()) {}
+
+    // not '\0' terminated
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return (size_ == 0); }
+    std::string str() const { return std::string(data_, size_); }
+
+    int compare(const StringRef& other) const {
+        const int result = memcmp(data_, other.data_, size_ < other.size_ ? size_ : other.size_);
+        if (result) {
+            return result;
+        }
+        return (size_ < other.size_) ? -1 : (size_ > other.size_ ? 1 : 0);
+    }
+    bool operator==(const StringRef& other) const {
+        return size_ == other.size_ && memcmp(data_, other.data_, size_) == 0;
+    }
+    bool operator!=(const StringRef& other) const { return !(*this == other); }
+    bool operator<(const StringRef& other) const { return compare(other) < 0; }
+};
+
+}// namespace serialflex
+
+#endif
@@ -0,0 +1,217 @@
+#ifndef __SERIALFLEX_TABLE_H__
+#define __SERIALFLEX_TABLE_H__
+
+#include <serialflex/json/decoder.h>
+#include <serialflex/json/direct_decoder.h>
+#include <serialflex/json/encoder.h>
+#include <serialflex/protobuf/decoder.h>
+#include <serialflex/protobuf/encoder.h>
+#include <serialflex/size_estimate.h>
+#include <serialflex/xml/decoder.h>
+#include <serialflex/xml/encoder.h>
+
+// Table-driven serialization. A type named with SERIALFLEX_TABLE runs its serialize() only once,
+// against a recording archive, and every archive then walks the recorded field table instead
+// of an instantiation of serialize() of its own. Each field points to the codec of its member
+// type, which is shared by all types with a member of that type, so the code per type shrinks
+// to the table. Types without the macro keep the template path.
+//
+//   struct Point { int32_t x; int32_t y; ... serialize() as usual ... };
+//   SERIALFLEX_TABLE(Point)// at global scope, after the definition
+//
+// serialize() must make the same calls for every object and only convert members of the
+// object; has flags must be members too. The type needs a default constructor. Fields added
+// with convert() have no field number and are left out of protobuf.
+#define SERIALFLEX_TABLE(type)                                                                     \
+    namespace serialflex {                                                                         \
+    namespace internal {                                                                           \
+    template <>                                                                                    \
+    struct UseTable<type> {                                                                        \
+        enum { value = true };                                                                     \
+    };                                                                                             \
+    }                                                                                              \
+    }
+
+namespace serialflex {
+
+namespace internal {
+
+// the archives a table can drive, the index of their codec function
+enum TableArchiveId {
+    TABLE_JSON_ENCODER = 0,
+    TABLE_JSON_DECODER,
+    TABLE_JSON_DIRECT_DECODER,
+    TABLE_XML_ENCODER,
+    TABLE_XML_DECODER,
+    TABLE_PROTOBUF_ENCODER,
+    TABLE_PROTOBUF_DECODER,
+    TABLE_PROTOBUF_SIZE,
+    TABLE_SIZE_ESTIMATE,
+    TABLE_ARCHIVES
+};
+
+#define SERIALFLEX_TABLE_ARCHIVE(archive, archive_id)                                              \
+    template <>                                                                                    \
+    struct TableArchive<archive> {                                                                 \
+        enum { value = true, id = archive_id };                                                    \
+    };
+SERIALFLEX_TABLE_ARCHIVE(JSONEncoder, TABLE_JSON_ENCODER)
+SERIALFLEX_TABLE_ARCHIVE(JSONDecoder, TABLE_JSON_DECODER)
+SERIALFLEX_TABLE_ARCHIVE(JSONDirectDecoder, TABLE_JSON_DIRECT_DECODER)
+SERIALFLEX_TABLE_ARCHIVE(XMLEncoder, TABLE_XML_ENCODER)
+SERIALFLEX_TABLE_ARCHIVE(XMLDecoder, TABLE_XML_DECODER)
+SERIALFLEX_TABLE_ARCHIVE(ProtobufEncoder, TABLE_PROTOBUF_ENCODER)
+SERIALFLEX_TABLE_ARCHIVE(ProtobufDecoder, TABLE_PROTOBUF_DECODER)
+SERIALFLEX_TABLE_ARCHIVE(protobuf::MessageByteSize, TABLE_PROTOBUF_SIZE)
+SERIALFLEX_TABLE_ARCHIVE(SizeEstimate, TABLE_SIZE_ESTIMATE)
+#undef SERIALFLEX_TABLE_ARCHIVE
+
+struct TableField;
+// one field for the archive, value and has_value point into the object
+typedef void (*TableOp)(void* archive, const TableField& field, void* value, bool* has_value);
+
+// what one member type does in each archive, NULL where it is left out
+struct TableCodec {
+    TableOp ops[TABLE_ARCHIVES];
+};
+
+// one convert() or operator& call of serialize()
+struct TableField {
+    const char* name;
+    uint32_t number;// 0 for convert()
+    protobuf::FieldType type;
+    protobuf::FieldType type2;
+    bool packed;
+    size_t value;    // offset in the object
+    size_t has_value;// offset in the object, NO_HAS_VALUE without a flag
+    const TableCodec* codec;
+};
+
+enum { NO_HAS_VALUE = (size_t)-1 };
+
+class EXPORTAPI MessageTable {
+    std::vector<TableField> fields_;
+
+public:
+    MessageTable() {}
+
+    void add(const TableField& field) { fields_.push_back(field); }
+    size_t size() const { return fields_.size(); }
+    const TableField& operator[](size_t idx) const { return fields_[idx]; }
+};
+
+// the fields of table for the archive with the given id, object is the start of the value
+EXPORTAPI void runTable(void* archive, uint32_t archive_id, const MessageTable& table,
+                        void* object);
+
+template <typename A, typename M>
+void convertOp(void* archive, const TableField& field, void* value, bool* has_value) {
+    static_cast<A*>(archive)->convert(field.name, *(M*)value, has_value);
+}
+
+template <typename A, typename M>
+void fieldOp(void* archive, const TableField& field, void* value, bool* has_value) {
+    const Field<M> item(field.name, field.number, field.type, *(M*)value, has_value, field.packed,
+                        field.type2);
+    *static_cast<A*>(archive) & item;
+}
+
+// protobuf goes by field numbers, which convert() does not have
+template <typename M>
+struct TableCodecs {
+    static const TableCodec by_name;
+    static const TableCodec by_field;
+};
+
+template <typename M>
+const TableCodec TableCodecs<M>::by_name = {{
+    &convertOp<JSONEncoder, M>,
+    &convertOp<JSONDecoder, M>,
+    &convertOp<JSONDirectDecoder, M>,
+    &convertOp<XMLEncoder, M>,
+    &convertOp<XMLDecoder, M>,
+    NULL,
+    NULL,
+    NULL,
+    &convertOp<SizeEstimate, M>,
+}};
+
+template <typename M>
+const TableCodec TableCodecs<M>::by_field = {{
+    &fieldOp<JSONEncoder, M>,
+    &fieldOp<JSONDecoder, M>,
+    &fieldOp<JSONDirectDecoder, M>,
+    &fieldOp<XMLEncoder, M>,
+    &fieldOp<XMLDecoder, M>,
+    &fieldOp<ProtobufEncoder, M>,
+    &fieldOp<ProtobufDecoder, M>,
+    &fieldOp<protobuf::MessageByteSize, M>,
+    &fieldOp<SizeEstimate, M>,
+}};
+
+// the archive serialize() runs against once per type, fields are stored as offsets into object
+class EXPORTAPI TableRecorder {
+    MessageTable& table_;
+    const char* object_;
+    size_t size_;
+
+    TableRecorder(const TableRecorder&);
+    TableRecorder& operator=(const TableRecorder&);
+
+public:
+    TableRecorder(MessageTable& table, const void* object, size_t size)
+        : table_(table), object_((const char*)object), size_(size) {}
+
+    template <typename T>
+    TableRecorder& operator&(const Field<T>& field) {
+        typedef typename TypeTraits<T>::Type Type;
+        add(field.getName(), field.getNumber(), field.getType(), field.getType2(),
+            field.getPacked(), &field.getValue(), field.has(), &TableCodecs<Type>::by_field);
+        return *this;
+    }
+
+    template <typename T>
+    TableRecorder& convert(const char* name, T& value, bool* has_value = NULL) {
+        typedef typename TypeTraits<T>::Type Type;
+        add(name, 0, protobuf::FIELDTYPE_NONE, protobuf::FIELDTYPE_NONE, false, &value, has_value,
+            &TableCodecs<Type>::by_name);
+        return *this;
+    }
+
+private:
+    // out of line, serialize() of every type calls it once per field
+    void add(const char* name, uint32_t number, protobuf::FieldType type,
+             protobuf::FieldType type2, bool packed, const void* value, const bool* has_value,
+             const TableCodec* codec);
+    size_t offset(const void* member) const;
+};
+
+template <typename T>
+const MessageTable* recordTable() {
+    MessageTable* table = new MessageTable();
+    T* sample = new T();
+    TableRecorder recorder(*table, sample, sizeof(T));
+    serializeWrapper(recorder, *sample);
+    delete sample;
+    return table;
+}
+
+// recorded from a default constructed object the first time the type is serialized
+template <typename T>
+const MessageTable& messageTable() {
+    static const MessageTable* table = recordTable<T>();
+    return *table;
+}
+
+}// namespace internal
+
+// found by argument dependent lookup from internal::serializeWrapper
+template <typename A, typename C>
+void serializeTable(A& archive, C& value) {
+    internal::runTable(&archive, internal::TableArchive<A>::id, internal::messageTable<C>(),
+                       &value);
+}
+
+}// namespace serialflex
+
+#endif
@@ -3,8 +3,18 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <map>
 #include <string>
 #include <vector>
+#if __cplusplus >= 201103L
+#include <array>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#endif
+#include <serialflex/flat_map.h>
+#include <serialflex/small_vector.h>
+#include <serialflex/string_ref.h>
 
 #ifdef _MSC_VER
 #ifdef EXPORTAPI
@@ -18,6 +28,13 @@
 
 namespace serialflex {
 
+// readable zero bytes a caller guarantees after length-delimited input in padded mode
+enum { INPUT_PADDING = 64 };
+
+// walks the field table of value, defined in table.h
+template <class A, class C>
+void serializeTable(A& archive, C& value);
+
 namespace internal {
 
 template <class T, class C>
@@ -25,10 +42,129 @@ void serialize(T& t, C& c) {
     c.serialize(t);
 }
 
+// types named with SERIALFLEX_TABLE
+template <class C>
+struct UseTable {
+    enum { value = false };
+};
+
+// archives that can walk a field table
+template <class T>
+struct TableArchive {
+    enum { value = false };
+};
+
+template <bool TABLE>
+struct SerializeDispatch {
+    template <class T, class C>
+    static void call(T& t, C& c) {
+        serialize(t, c);
+    }
+};
+
+template <>
+struct SerializeDispatch<true> {
+    template <class T, class C>
+    static void call(T& t, C& c) {
+        serialflex::serializeTable(t, c);
+    }
+};
+
 template <class T, class C>
 void serializeWrapper(T& t, C& c) {
-    serialize(t, c);
+    SerializeDispatch<UseTable<C>::value && TableArchive<T>::value>::call(t, c);
+}
+
+// one address per type, names a message type at run time without RTTI
+template <typename T>
+struct TypeKey {
+    static char id;
+};
+template <typename T>
+char TypeKey<T>::id = 0;
+
+// containers are filled in place, decoded items are never copied into them afterwards
+
+// sequences hold the size items of the input, fixed arrays keep their length and reset what
+// the input does not cover; returns how many items to decode
+template <typename T>
+size_t resizeItems(std::vector<T>& value, size_t size) {
+    value.resize(size);
+    return size;
+}
+
+template <typename T, size_t N>
+size_t resizeItems(SmallVector<T, N>& value, size_t size) {
+    value.resize(size);
+    return size;
+}
+
+template <typename T>
+size_t resizeItems(T* value, size_t capacity, size_t size) {
+    for (size_t idx = size; idx < capacity; ++idx) {
+        value[idx] = T();
+    }
+    return (size < capacity) ? size : capacity;
+}
+
+template <typename T, size_t N>
+size_t resizeItems(T (&value)[N], size_t size) {
+    return resizeItems(value, N, size);
+}
+
+#if __cplusplus >= 201103L
+template <typename T, size_t N>
+size_t resizeItems(std::array<T, N>& value, size_t size) {
+    return resizeItems(value.data(), N, size);
+}
+#endif
+
+// a default value inserted under key, NULL when the key is taken already (the first one wins)
+template <typename K, typename V>
+V* insertItem(std::map<K, V>& value, const K& key) {
+    const size_t size = value.size();
+    // encoders write maps in key order, the end is the usual position
+#if __cplusplus >= 201103L
+    typename std::map<K, V>::iterator it = value.emplace_hint(
+        value.end(), std::piecewise_construct, std::forward_as_tuple(key), std::tuple<>());
+#else
+    typename std::map<K, V>::iterator it = value.insert(value.end(), std::pair<K, V>(key, V()));
+#endif
+    return (value.size() != size) ? &it->second : NULL;
 }
+
+template <typename K, typename V>
+V* insertItem(FlatMap<K, V>& value, const K& key) {
+    std::pair<typename FlatMap<K, V>::iterator, bool> result =
+        value.insert(typename FlatMap<K, V>::value_type(key, V()));
+    return result.second ? &result.first->second : NULL;
+}
+
+#if __cplusplus >= 201103L
+template <typename K, typename V>
+V* insertItem(std::unordered_map<K, V>& value, const K& key) {
+    std::pair<typename std::unordered_map<K, V>::iterator, bool> result = value.emplace(
+        std::piecewise_construct, std::forward_as_tuple(key), std::tuple<>());
+    return result.second ? &result.first->second : NULL;
+}
+#endif
+
+// room for size more entries where the container can hold it
+template <typename K, typename V>
+void reserveItems(std::map<K, V>&, size_t) {}
+
+template <typename K, typename V>
+void reserveItems(FlatMap<K, V>& value, size_t size) {
+    value.reserve(value.size() + size);
+}
+
+#if __cplusplus >= 201103L
+template <typename K, typename V>
+void reserveItems(std::unordered_map<K, V>& value, size_t size) {
+    value.reserve(value.size() + size);
+}
+#endif
+
 #if __cplusplus >= 201103L
 template <typename T, bool is_enum = std::is_enum<T>::value>
 struct TypeTraits {
@@ -131,6 +267,46 @@ struct TypeTraits<T, true> {
 
 namespace STOT {
 enum { BUFSIZE = 128 };
+
+// same leniency as atoi: leading blanks, a sign and the digits up to the first other character
+template <typename T>
+inline T parseInteger(const char* str, size_t size) {
+    size_t pos = 0;
+    while (pos < size && (str[pos] == ' ' || ('\t' <= str[pos] && str[pos] <= '\r'))) {
+        ++pos;
+    }
+    bool negative = false;
+    if (pos < size && (str[pos] == '-' || str[pos] == '+')) {
+        negative = (str[pos++] == '-');
+    }
+    uint64_t value = 0;
+    for (; pos < size && '0' <= str[pos] && str[pos] <= '9'; ++pos) {
+        value = value * 10 + (uint64_t)(str[pos] - '0');
+    }
+    return (T)(negative ? 0 - value : value);
+}
+
+// '\0' terminated decimal text in buffer, returns its length
+inline size_t formatInteger(uint64_t value, bool negative, char* buffer) {
+    char digits[20];
+    size_t count = 0;
+    do {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+    size_t size = 0;
+    if (negative) {
+        buffer[size++] = '-';
+    }
+    while (count) {
+        buffer[size++] = digits[--count];
+    }
+    buffer[size] = '\0';
+    return size;
+}
+
+// strto/tostr convert through '\0' terminated text, parse/format take the key as it lies in
+// the input and write into a buffer of BUFSIZE bytes, neither allocates for numbers
 template <typename T>
 struct type {};
 // bool
@@ -138,6 +314,10 @@ template <>
 struct type<bool> {
     static inline bool strto(const char* str) { return atoi(str) != 0; }
     static inline std::string tostr(bool v) { return v ? "1" : "0"; }
+    static inline bool parse(const char* str, size_t size) {
+        return parseInteger<int32_t>(str, size) != 0;
+    }
+    static inline size_t format(bool v, char* buffer) { return formatInteger(v, false, buffer); }
 };
 // int32_t
 template <>
@@ -148,6 +328,12 @@ struct type<int32_t> {
         snprintf(trans_buffer, BUFSIZE, "%d", v);
         return std::string(trans_buffer);
     }
+    static inline int32_t parse(const char* str, size_t size) {
+        return parseInteger<int32_t>(str, size);
+    }
+    static inline size_t format(int32_t v, char* buffer) {
+        return formatInteger(v < 0 ? 0 - (uint64_t)v : (uint64_t)v, v < 0, buffer);
+    }
 };
 // uint32_t
 template <>
@@ -158,6 +344,10 @@ struct type<uint32_t> {
         snprintf(trans_buffer, BUFSIZE, "%u", v);
         return std::string(trans_buffer);
     }
+    static inline uint32_t parse(const char* str, size_t size) {
+        return parseInteger<uint32_t>(str, size);
+    }
+    static inline size_t format(uint32_t v, char* buffer) { return formatInteger(v, false, buffer); }
 };
 // int64_t
 template <>
@@ -168,6 +358,12 @@ struct type<int64_t> {
         snprintf(trans_buffer, BUFSIZE, "%lld", (long long)v);
         return std::string(trans_buffer);
     }
+    static inline int64_t parse(const char* str, size_t size) {
+        return parseInteger<int64_t>(str, size);
+    }
+    static inline size_t format(int64_t v, char* buffer) {
+        return formatInteger(v < 0 ? 0 - (uint64_t)v : (uint64_t)v, v < 0, buffer);
+    }
 };
 // uint64_t
 template <>
@@ -178,12 +374,36 @@ struct type<uint64_t> {
         snprintf(trans_buffer, BUFSIZE, "%llu", (long long)v);
         return std::string(trans_buffer);
     }
+    static inline uint64_t parse(const char* str, size_t size) {
+        return parseInteger<uint64_t>(str, size);
+    }
+    static inline size_t format(uint64_t v, char* buffer) { return formatInteger(v, false, buffer); }
 };
 // std::string
 template <>
 struct type<std::string> {
     static inline const std::string& strto(const std::string& str) { return str; }
     static inline const std::string& tostr(const std::string& v) { return v; }
+    static inline std::string parse(const char* str, size_t size) { return std::string(str, size); }
+};
+
+// the text of a map key for the encoders, numbers are formatted on the stack. Keys are passed on
+// as field names, '\0' terminated, so a std::string key ends at its first '\0' byte
+template <typename T>
+class KeyText {
+    char buffer_[BUFSIZE];
+
+public:
+    explicit KeyText(const T& key) { type<T>::format(key, buffer_); }
+    const char* c_str() const { return buffer_; }
+};
+template <>
+class KeyText<std::string> {
+    const std::string& key_;
+
+public:
+    explicit KeyText(const std::string& key): key_(key) {}
+    const char* c_str() const { return key_.c_str(); }
 };
 
 }// namespace STOT
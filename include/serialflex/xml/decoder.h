@@ -11,19 +11,31 @@ namespace xml {
 class Reader;
 }// namespace xml
 
-struct GenericNode;
+struct TapeNode;
 class EXPORTAPI XMLDecoder {
     bool convert_by_type_; // convert by field type
     bool case_insensitive_;// key case insensitive
+    bool padded_;          // INPUT_PADDING zero bytes follow length-delimited input
     xml::Reader* reader_;
-    const GenericNode* current_;
+    const TapeNode* current_;
 
     XMLDecoder(const XMLDecoder&);
     XMLDecoder& operator=(const XMLDecoder&);
 
 public:
+    XMLDecoder();
     XMLDecoder(const char* str, bool case_insensitive = false);
+    // data needs no '\0' terminator
+    XMLDecoder(const char* data, size_t len, bool case_insensitive = false);
     ~XMLDecoder();
+
+    // parse a new document, the node storage of the previous one is reused
+    bool reset(const char* str);
+    bool reset(const char* data, size_t len);
+    // length-delimited input is followed by INPUT_PADDING readable zero bytes
+    XMLDecoder& setPadded(bool padded);
+    // key case insensitive
+    XMLDecoder& setCaseInsensitive(bool case_insensitive);
     
     const char* getError() const;
 
@@ -47,8 +59,10 @@ public:
         if (!current_) {
             return false;
         }
-        const GenericNode* parent = current_;
+        const TapeNode* parent = current_;
+        enterShape(&internal::TypeKey<T>::id);
         internal::serializeWrapper(*this, value);
+        leaveShape();
 
         if (parent != current_) {
             return false;
@@ -61,67 +75,52 @@ public:
 
     template <typename T>
     bool operator>>(std::vector<T>& value) {
-        if (!current_) {
-            return false;
-        }
-        const GenericNode* parent = current_;
-        // uint32_t size = XMLDecoder::getObjectSize(current_);
-        // if (size) {
-        //     value.resize(size);
-        // }
-        const GenericNode* parent_temp = current_;
-        current_ = XMLDecoder::getChild(current_);
-        value.clear();
-        for (uint32_t idx = 0; current_; (current_ = XMLDecoder::getNext(current_)), ++idx) {
-            T item = T();
-            decodeValue("value", *(typename internal::TypeTraits<T>::Type*)(&item), NULL);
-            value.push_back(item);
-        }
-        current_ = parent_temp;
+        return decodeItemsRoot<T>(value);
+    }
 
-        if (parent != current_) {
-            return false;
-        }
-        if (getError()) {
-            return false;
-        }
-        return true;
+    template <typename T, size_t N>
+    bool operator>>(SmallVector<T, N>& value) {
+        return decodeItemsRoot<T>(value);
+    }
+
+    template <typename T, size_t N>
+    bool operator>>(T (&value)[N]) {
+        return decodeItemsRoot<T>(value);
     }
 
+#if __cplusplus >= 201103L
+    template <typename T, size_t N>
+    bool operator>>(std::array<T, N>& value) {
+        return decodeItemsRoot<T>(value);
+    }
+#endif
+
     template <typename K, typename V>
     bool operator>>(std::map<K, V>& value) {
-        if (!current_) {
-            return false;
-        }
-        const GenericNode* parent = current_;
-        value.clear();
-        const GenericNode* parent_temp = current_;
-        for (const GenericNode* child = XMLDecoder::getChild(parent); child;
-             child = XMLDecoder::getNext(child)) {
-            K key = K();
-            V item = V();
-            decodeValue("key", *(typename internal::TypeTraits<K>::Type*)(&key), NULL);
-            decodeValue("value", *(typename internal::TypeTraits<V>::Type*)(&item), NULL);
-            value.insert(std::pair<K, V>(key, item));
-        }
-        current_ = parent_temp;
+        return decodeRoot(value);
+    }
 
-        if (parent != current_) {
-            return false;
-        }
-        if (getError()) {
-            return false;
-        }
-        return true;
+    template <typename K, typename V>
+    bool operator>>(FlatMap<K, V>& value) {
+        return decodeRoot(value);
+    }
+
+#if __cplusplus >= 201103L
+    template <typename K, typename V>
+    bool operator>>(std::unordered_map<K, V>& value) {
+        return decodeRoot(value);
     }
+#endif
 
 private:
     template <typename T>
     void decodeValue(const char* name, T& value, bool* has_value) {
-        const GenericNode* parent = current_;
+        const TapeNode* parent = current_;
         current_ = XMLDecoder::getObjectItem(current_, name, case_insensitive_);
         if (current_) {
+            enterShape(&internal::TypeKey<T>::id);
             internal::serializeWrapper(*this, value);
+            leaveShape();
             if (has_value) *has_value = true;
         }
         current_ = parent;
@@ -129,22 +128,49 @@ private:
 
     template <typename T>
     void decodeValue(const char* name, std::vector<T>& value, bool* has_value) {
-        const GenericNode* parent = current_;
+        decodeItems<T>(name, value, has_value);
+    }
+
+    template <typename T, size_t N>
+    void decodeValue(const char* name, SmallVector<T, N>& value, bool* has_value) {
+        decodeItems<T>(name, value, has_value);
+    }
+
+    template <typename T, size_t N>
+    void decodeValue(const char* name, T (&value)[N], bool* has_value) {
+        decodeItems<T>(name, value, has_value);
+    }
+
+#if __cplusplus >= 201103L
+    template <typename T, size_t N>
+    void decodeValue(const char* name, std::array<T, N>& value, bool* has_value) {
+        decodeItems<T>(name, value, has_value);
+    }
+#endif
+
+    template <typename T, typename S>
+    bool decodeItemsRoot(S& value) {
+        if (!current_) {
+            return false;
+        }
+        const TapeNode* parent = current_;
+        readItems<T>(value);
+
+        if (parent != current_) {
+            return false;
+        }
+        if (getError()) {
+            return false;
+        }
+        return true;
+    }
+
+    template <typename T, typename S>
+    void decodeItems(const char* name, S& value, bool* has_value) {
+        const TapeNode* parent = current_;
         current_ = XMLDecoder::getObjectItem(current_, name, case_insensitive_);
         if (current_) {
-            value.clear();
-            // uint32_t size = XMLDecoder::getObjectSize(current_);
-            // if (size) {
-            //     value.resize(size);
-            // }
-            const GenericNode* parent_temp = current_;
-            current_ = XMLDecoder::getChild(current_);
-            for (uint32_t idx = 0; current_; (current_ = XMLDecoder::getNext(current_)), ++idx) {
-                T item = T();
-                decodeValue(NULL, *(typename internal::TypeTraits<T>::Type*)(&item), NULL);
-                value.push_back(item);
-            }
-            current_ = parent_temp;
+            readItems<T>(value);
             if (has_value) {
                 *has_value = true;
             }
@@ -152,23 +178,63 @@ private:
         current_ = parent;
     }
 
+    // the children of current_ are the items
+    template <typename T, typename S>
+    void readItems(S& value) {
+        // every item starts from its default value
+        internal::resizeItems(value, 0);
+        const size_t size = internal::resizeItems(value, XMLDecoder::getObjectSize(current_));
+        const TapeNode* parent_temp = current_;
+        current_ = XMLDecoder::getChild(current_);
+        for (size_t idx = 0; current_ && (idx < size);
+             (current_ = XMLDecoder::getNext(current_)), ++idx) {
+            decodeValue(NULL, *(typename internal::TypeTraits<T>::Type*)(&value[idx]), NULL);
+        }
+        current_ = parent_temp;
+    }
+
     template <typename K, typename V>
     void decodeValue(const char* name, std::map<K, V>& value, bool* has_value) {
-        const GenericNode* parent = current_;
+        decodeMap(name, value, has_value);
+    }
+
+    template <typename K, typename V>
+    void decodeValue(const char* name, FlatMap<K, V>& value, bool* has_value) {
+        decodeMap(name, value, has_value);
+    }
+
+#if __cplusplus >= 201103L
+    template <typename K, typename V>
+    void decodeValue(const char* name, std::unordered_map<K, V>& value, bool* has_value) {
+        decodeMap(name, value, has_value);
+    }
+#endif
+
+    template <typename M>
+    bool decodeRoot(M& value) {
+        if (!current_) {
+            return false;
+        }
+        const TapeNode* parent = current_;
+        value.clear();
+        readEntries(value);
+
+        if (parent != current_) {
+            return false;
+        }
+        if (getError()) {
+            return false;
+        }
+        return true;
+    }
+
+    template <typename M>
+    void decodeMap(const char* name, M& value, bool* has_value) {
+        const TapeNode* parent = current_;
         current_ = XMLDecoder::getObjectItem(current_, name, case_insensitive_);
         if (current_) {
             value.clear();
-
-            const GenericNode* parent_temp = current_;
-            for (current_ = XMLDecoder::getChild(current_); current_;
-                 current_ = XMLDecoder::getNext(current_)) {
-                K key = K();
-                V item = V();
-                decodeValue("key", *(typename internal::TypeTraits<K>::Type*)(&key), NULL);
-                decodeValue("value", *(typename internal::TypeTraits<V>::Type*)(&item), NULL);
-                value.insert(std::pair<K, V>(key, item));
-            }
-            current_ = parent_temp;
+            readEntries(value);
             if (has_value) {
                 *has_value = true;
             }
@@ -176,6 +242,25 @@ private:
         current_ = parent;
     }
 
+    // the <value> children of current_, each with a <key> and a <value>
+    template <typename M>
+    void readEntries(M& value) {
+        typedef typename M::key_type K;
+        typedef typename M::mapped_type V;
+        internal::reserveItems(value, XMLDecoder::getObjectSize(current_));
+        const TapeNode* parent_temp = current_;
+        for (current_ = XMLDecoder::getChild(current_); current_;
+             current_ = XMLDecoder::getNext(current_)) {
+            K key = K();
+            decodeValue("key", *(typename internal::TypeTraits<K>::Type*)(&key), NULL);
+            V* item = internal::insertItem(value, key);
+            if (item) {
+                decodeValue("value", *(typename internal::TypeTraits<V>::Type*)item, NULL);
+            }
+        }
+        current_ = parent_temp;
+    }
+
     void decodeValue(const char* name, bool& value, bool* has_value);
     void decodeValue(const char* name, uint32_t& value, bool* has_value);
     void decodeValue(const char* name, int32_t& value, bool* has_value);
@@ -184,15 +269,23 @@ private:
     void decodeValue(const char* name, float& value, bool* has_value);
     void decodeValue(const char* name, double& value, bool* has_value);
     void decodeValue(const char* name, std::string& value, bool* has_value);
+    void decodeValue(const char* name, StringRef& value, bool* has_value);
     void decodeValue(const char* name, std::vector<bool>& value, bool* has_value);
-    bool item2Bool(const GenericNode& item) const;
+    bool item2Bool(const TapeNode& item) const;
+
+    // text of an element, or of its first data node
+    const char* getText(const TapeNode& item, uint32_t& size) const;
+
+    // the fields of type are read from current_ until leaveShape
+    void enterShape(const void* type);
+    void leaveShape();
 
     // for value
-    static uint32_t getObjectSize(const GenericNode* parent);
-    static const GenericNode* getObjectItem(const GenericNode* parent, const char* name,
-                                            bool case_insensitive);
-    static const GenericNode* getChild(const GenericNode* parent);
-    static const GenericNode* getNext(const GenericNode* parent);
+    static uint32_t getObjectSize(const TapeNode* parent);
+    const TapeNode* getObjectItem(const TapeNode* parent, const char* name,
+                                  bool case_insensitive) const;
+    static const TapeNode* getChild(const TapeNode* parent);
+    static const TapeNode* getNext(const TapeNode* parent);
 
     static void dealWithString(std::string& str);
     static void insert_coded_character(std::string& str, unsigned long code);
@@ -3,6 +3,9 @@
 
 #include <map>
 #include <serialflex/field.h>
+#include <serialflex/parallel.h>
+#include <serialflex/sink.h>
+#include <serialflex/size_estimate.h>
 #include <serialflex/traits.h>
 
 namespace serialflex {
@@ -13,14 +16,29 @@ class Writer;
 
 class EXPORTAPI XMLEncoder {
     xml::Writer* writer_;
+    bool formatted_;
+    bool presize_;    // large documents are counted first and the sink told their length
+    uint32_t threads_;// for the items of root sequences
 
     XMLEncoder(const XMLEncoder&);
     XMLEncoder& operator=(const XMLEncoder&);
 
 public:
     explicit XMLEncoder(std::string& str, bool formatted = false);
+    // the document goes out through sink, which is flushed after each operator<<
+    explicit XMLEncoder(OutputSink& sink, bool formatted = false);
     ~XMLEncoder();
 
+    // Root sequences of PARALLEL_ITEMS items or more are encoded by up to threads threads, in
+    // chunks written to strings of their own and then to the output in order; the output is
+    // the same as with one thread, and it is held twice in memory meanwhile. 1 by default.
+    void setThreads(uint32_t threads) { threads_ = threads; }
+
+    // Documents estimated at PRESIZE_BYTES or more are written once into a CountingSink first
+    // and the exact length is passed to the sink, a string is then allocated once and without
+    // spare capacity. The extra pass makes encoding slower, off by default.
+    void setPresize(bool presize) { presize_ = presize; }
+
     template <typename T>
     XMLEncoder& operator&(const Field<T>& field) {
         return convert(field.getName(), field.getValue(), field.has());
@@ -36,6 +54,7 @@ public:
 
     template <typename T>
     bool operator<<(const T& value) {
+        presize(value);
         startObject("serialflex");
         const typename internal::TypeTraits<T>::Type& tratis_value =
             *(const typename internal::TypeTraits<T>::Type*)&value;
@@ -47,35 +66,78 @@ public:
 
     template <typename T>
     bool operator<<(const std::vector<T>& value) {
+        return encodeRoot(value, value.empty() ? NULL : &value[0], value.size());
+    }
+
+    bool operator<<(const std::vector<bool>& value) {
+        presize(value);
         if (value.empty()) {
             return false;
         }
-        startObject("serialflex");
-        int32_t size = (int32_t)value.size();
-        for (int32_t i = 0; i < size; ++i) {
-            encodeValue("value", *(const typename internal::TypeTraits<T>::Type*)(&value.at(i)));
-        }
-        endObject("serialflex");
+        encodeValue("serialflex", value);
         return writerResult();
     }
 
+    template <typename T, size_t N>
+    bool operator<<(const SmallVector<T, N>& value) {
+        return encodeRoot(value, value.data(), value.size());
+    }
+
+    template <typename T, size_t N>
+    bool operator<<(const T (&value)[N]) {
+        return encodeRoot(value, value, N);
+    }
+
+#if __cplusplus >= 201103L
+    template <typename T, size_t N>
+    bool operator<<(const std::array<T, N>& value) {
+        return encodeRoot(value, value.data(), N);
+    }
+#endif
+
     template <typename K, typename V>
     bool operator<<(const std::map<K, V>& value) {
-        if (value.empty()) {
-            return false;
+        presize(value);
+        return encodeRoot(value);
+    }
+
+    template <typename K, typename V>
+    bool operator<<(const FlatMap<K, V>& value) {
+        presize(value);
+        return encodeRoot(value);
+    }
+
+#if __cplusplus >= 201103L
+    template <typename K, typename V>
+    bool operator<<(const std::unordered_map<K, V>& value) {
+        presize(value);
+        return encodeRoot(value);
+    }
+#endif
+
+    enum { PARALLEL_ITEMS = 1024, PRESIZE_BYTES = 4 * 1024 * 1024 };
+
+private:
+    enum { CHUNK_ITEMS = 256, CHUNKS_PER_THREAD = 8 };
+
+    template <typename T>
+    void presize(const T& value) {
+        if (!presize_) {
+            return;
         }
-        startObject("serialflex");
-        for (typename std::map<K, V>::const_iterator it = value.begin(); it != value.end(); ++it) {
-            startObject("value");
-            encodeValue("key", *(const typename internal::TypeTraits<K>::Type*)(&it->first));
-            encodeValue("value", *(const typename internal::TypeTraits<V>::Type*)(&it->second));
-            endObject("value");
+        SizeEstimate estimate(2, 5);
+        estimate.add(value);
+        if (estimate.size() < PRESIZE_BYTES) {
+            return;
         }
-        endObject("serialflex");
-        return writerResult();
+        CountingSink counter;
+        XMLEncoder sizer(counter, formatted_);
+        // the declaration is written already
+        const size_t declaration = counter.size();
+        sizer << value;
+        writerExpect(counter.size() - declaration);
     }
 
-private:
     template <typename T>
     void encodeValue(const char* name, const T& value) {
         startObject(name);
@@ -88,21 +150,143 @@ private:
 
     template <typename T>
     void encodeValue(const char* name, const std::vector<T>& value) {
+        encodeItems(name, value.empty() ? NULL : &value[0], value.size());
+    }
+
+    template <typename T, size_t N>
+    void encodeValue(const char* name, const SmallVector<T, N>& value) {
+        encodeItems(name, value.data(), value.size());
+    }
+
+    template <typename T, size_t N>
+    void encodeValue(const char* name, const T (&value)[N]) {
+        encodeItems(name, value, N);
+    }
+
+#if __cplusplus >= 201103L
+    template <typename T, size_t N>
+    void encodeValue(const char* name, const std::array<T, N>& value) {
+        encodeItems(name, value.data(), N);
+    }
+#endif
+
+    template <typename S, typename T>
+    bool encodeRoot(const S& sequence, const T* value, size_t size) {
+        if (threads_ > 1 && size >= PARALLEL_ITEMS) {
+            encodeChunks(value, size);
+            return writerResult();
+        }
+        presize(sequence);
+        if (!size) {
+            return false;
+        }
+        encodeItems("serialflex", value, size);
+        return writerResult();
+    }
+
+    template <typename T>
+    struct Chunks {
+        const T* value;
+        size_t size;
+        size_t count;
+        bool formatted;
+        std::string* pieces;
+        size_t* starts;// where the bytes of a piece begin that belong to the document
+    };
+
+    // Chunk idx is written the way the whole document would be, the chunks before it cut off:
+    // the first one starts behind the declaration, the others write the item before their own
+    // and start behind that. The last chunk closes the root element.
+    template <typename T>
+    static void encodeChunk(void* context, uint32_t worker, size_t idx) {
+        (void)worker;
+        const Chunks<T>& chunks = *static_cast<const Chunks<T>*>(context);
+        const size_t begin = idx * chunks.size / chunks.count;
+        const size_t end = (idx + 1) * chunks.size / chunks.count;
+        XMLEncoder encoder(chunks.pieces[idx], chunks.formatted);
+        chunks.starts[idx] = encoder.writerSize();
+        encoder.startObject("serialflex");
+        if (idx) {
+            encoder.encodeValue("value", *(const typename internal::TypeTraits<T>::Type*)(
+                                             &chunks.value[begin - 1]));
+            chunks.starts[idx] = encoder.writerSize();
+        }
+        for (size_t i = begin; i < end; ++i) {
+            encoder.encodeValue("value",
+                                *(const typename internal::TypeTraits<T>::Type*)(&chunks.value[i]));
+        }
+        if (end == chunks.size) {
+            encoder.endObject("serialflex");
+        }
+    }
+
+    template <typename T>
+    void encodeChunks(const T* value, size_t size) {
+        size_t count = size / CHUNK_ITEMS;
+        if (count > (size_t)threads_ * CHUNKS_PER_THREAD) {
+            count = (size_t)threads_ * CHUNKS_PER_THREAD;
+        }
+        std::vector<std::string> pieces(count);
+        std::vector<size_t> starts(count, 0);
+        const Chunks<T> chunks = {value, size, count, formatted_, &pieces[0], &starts[0]};
+        internal::parallelFor(count, threads_, &encodeChunk<T>, (void*)&chunks);
+        size_t length = 0;
+        for (size_t idx = 0; idx < count; ++idx) {
+            length += pieces[idx].size() - starts[idx];
+        }
+        writerExpect(length);
+        for (size_t idx = 0; idx < count; ++idx) {
+            writerWrite(pieces[idx].data() + starts[idx], pieces[idx].size() - starts[idx]);
+            std::string().swap(pieces[idx]);
+        }
+    }
+
+    // one <value> element per item
+    template <typename T>
+    void encodeItems(const char* name, const T* value, size_t size) {
         startObject(name);
-        int32_t size = (int32_t)value.size();
-        for (int32_t i = 0; i < size; ++i) {
-            encodeValue("value", *(const typename internal::TypeTraits<T>::Type*)(&value.at(i)));
+        for (size_t i = 0; i < size; ++i) {
+            encodeValue("value", *(const typename internal::TypeTraits<T>::Type*)(&value[i]));
         }
         endObject(name);
     }
 
     template <typename K, typename V>
     void encodeValue(const char* name, const std::map<K, V>& value) {
+        encodeMap(name, value);
+    }
+
+    template <typename K, typename V>
+    void encodeValue(const char* name, const FlatMap<K, V>& value) {
+        encodeMap(name, value);
+    }
+
+#if __cplusplus >= 201103L
+    template <typename K, typename V>
+    void encodeValue(const char* name, const std::unordered_map<K, V>& value) {
+        encodeMap(name, value);
+    }
+#endif
+
+    template <typename M>
+    bool encodeRoot(const M& value) {
+        if (value.empty()) {
+            return false;
+        }
+        encodeMap("serialflex", value);
+        return writerResult();
+    }
+
+    // one <value> element with <key> and <value> per entry
+    template <typename M>
+    void encodeMap(const char* name, const M& value) {
+        typedef typename internal::TypeTraits<typename M::key_type>::Type Key;
+        typedef typename internal::TypeTraits<typename M::mapped_type>::Type Item;
         startObject(name);
-        for (typename std::map<K, V>::const_iterator it = value.begin(); it != value.end(); ++it) {
+        for (typename M::const_iterator it = value.begin(); it != value.end(); ++it) {
             startObject("value");
-            encodeValue("key", *(const typename internal::TypeTraits<K>::Type*)(&it->first));
-            encodeValue("value", *(const typename internal::TypeTraits<V>::Type*)(&it->second));
+            encodeValue("key", *(const Key*)(&it->first));
+            encodeValue("value", *(const Item*)(&it->second));
             endObject("value");
         }
         endObject(name);
@@ -116,6 +300,7 @@ private:
     void encodeValue(const char* name, const float& value);
     void encodeValue(const char* name, const double& value);
     void encodeValue(const char* name, const std::string& value);
+    void encodeValue(const char* name, const StringRef& value);
     void encodeValue(const char* name, const std::vector<bool>& value);
     //
     void startObject(const char* name);
@@ -123,6 +308,9 @@ private:
 
     // for Writer
     bool writerResult() const;
+    void writerExpect(size_t size);
+    size_t writerSize() const;
+    void writerWrite(const char* data, size_t size);
 };
 
 }// namespace serialflex
@@ -3,133 +3,72 @@
 
 namespace serialflex {
 
-static unsigned parse_hex4(const char* str) {
-    unsigned h = 0;
-    if (*str >= '0' && *str <= '9')
-        h += (*str) - '0';
-    else if (*str >= 'A' && *str <= 'F')
-        h += 10 + (*str) - 'A';
-    else if (*str >= 'a' && *str <= 'f')
-        h += 10 + (*str) - 'a';
-    else
-        return 0;
-    h = h << 4;
-    str++;
-    if (*str >= '0' && *str <= '9')
-        h += (*str) - '0';
-    else if (*str >= 'A' && *str <= 'F')
-        h += 10 + (*str) - 'A';
-    else if (*str >= 'a' && *str <= 'f')
-        h += 10 + (*str) - 'a';
-    else
-        return 0;
-    h = h << 4;
-    str++;
-    if (*str >= '0' && *str <= '9')
-        h += (*str) - '0';
-    else if (*str >= 'A' && *str <= 'F')
-        h += 10 + (*str) - 'A';
-    else if (*str >= 'a' && *str <= 'f')
-        h += 10 + (*str) - 'a';
-    else
-        return 0;
-    h = h << 4;
-    str++;
-    if (*str >= '0' && *str <= '9')
-        h += (*str) - '0';
-    else if (*str >= 'A' && *str <= 'F')
-        h += 10 + (*str) - 'A';
-    else if (*str >= 'a' && *str <= 'f')
-        h += 10 + (*str) - 'a';
-    else
-        return 0;
-    return h;
-}
-
-/* Parse the input text into an unescaped cstring, and populate item. */
-static const unsigned char firstByteMark[7] = {0x00, 0x00, 0xC0, 0xE0, 0xF0, 0xF8, 0xFC};
-static bool parse_string(std::string& strValue, const char* str, uint32_t length) {
-    if (!length) {
-        return false;
-    } /* not a string! */
-    const char* ptr = str;
-    unsigned uc, uc2;
-    for (uint32_t i = 0; i < length; ++i) {
-        if (ptr[i] != '\\') {
-            strValue.append(1, ptr[i]);
-        } else {
-            ++i;
-            switch (ptr[i]) {
-                case 'b':
-                    strValue.append(1, '\b');
-                    break;
-                case 'f':
-                    strValue.append(1, '\f');
-                    break;
-                case 'n':
-                    strValue.append(1, '\n');
-                    break;
-                case 'r':
-                    strValue.append(1, '\r');
-                    break;
-                case 't':
-                    strValue.append(1, '\t');
-                    break;
-                case 'u':      /* transcode utf16 to utf8. */
-                    uc = parse_hex4(ptr + i + 1);
-                    i += 4;    /* get the unicode char. */
-                    if ((uc >= 0xDC00 && uc <= 0xDFFF) || uc == 0)
-                        break; /* check for invalid.    */
-                    /* UTF16 surrogate pairs.    */
-                    if (uc >= 0xD800 && uc <= 0xDBFF) {
-                        if (ptr[i + 1] != '\\' || ptr[i + 2] != 'u')
-                            break; /* missing second-half of surrogate.    */
-                        uc2 = parse_hex4(ptr + i + 3);
-                        i += 6;
-                        if (uc2 < 0xDC00 || uc2 > 0xDFFF)
-                            break; /* invalid second-half of surrogate.    */
-                        uc = 0x10000 + (((uc & 0x3FF) << 10) | (uc2 & 0x3FF));
-                    }
-
-                    if (uc < 0x80) {
-                        strValue.append(1, uc | firstByteMark[1]);
-                    } else if (uc < 0x800) {
-                        strValue.append(1, '\0');
-                        strValue.append(1, (uc | 0x80) & 0xBF);
-                        uc >>= 6;
-                    } else if (uc < 0x10000) {
-                        strValue.append(2, '\0');
-                        strValue.append(1, (uc | 0x80) & 0xBF);
-                        uc >>= 6;
-                    } else {
-                        strValue.append(3, '\0');
-                        strValue.append(1, (uc | 0x80) & 0xBF);
-                        uc >>= 6;
-                    }
-                    break;
-                default:
-                    strValue.append(1, ptr[i]);
-                    break;
-            }
-        }
-    }
-    return true;
+JSONDecoder::JSONDecoder()
+    : convert_by_type_(true), case_insensitive_(false), padded_(false), current_(NULL),
+      threads_(1) {
+    reader_ = new json::Reader();
 }
 
 JSONDecoder::JSONDecoder(const char* str, bool case_insensitive)
-    : convert_by_type_(true), case_insensitive_(case_insensitive), current_(NULL) {
+    : convert_by_type_(true), case_insensitive_(case_insensitive), padded_(false), current_(NULL),
+      threads_(1) {
     reader_ = new json::Reader();
     current_ = reader_->parse(str);
     assert(current_);
 }
 
-JSONDecoder::~JSONDecoder() { delete reader_; }
+JSONDecoder::JSONDecoder(const char* data, size_t len, bool case_insensitive)
+    : convert_by_type_(true), case_insensitive_(case_insensitive), padded_(false), current_(NULL),
+      threads_(1) {
+    reader_ = new json::Reader();
+    current_ = reader_->parse(data, len, padded_);
+    assert(current_);
+}
+
+JSONDecoder::~JSONDecoder() {
+    for (size_t idx = 0; idx < workers_.size(); ++idx) {
+        delete workers_[idx];
+    }
+    delete reader_;
+}
+
+bool JSONDecoder::reset(const char* str) {
+    current_ = reader_->parse(str);
+    // what the workers kept belongs to the previous document
+    for (size_t idx = 0; idx < workers_.size(); ++idx) {
+        workers_[idx]->reader_->attach(*reader_);
+    }
+    return current_ != NULL;
+}
+
+bool JSONDecoder::reset(const char* data, size_t len) {
+    current_ = reader_->parse(data, len, padded_);
+    for (size_t idx = 0; idx < workers_.size(); ++idx) {
+        workers_[idx]->reader_->attach(*reader_);
+    }
+    return current_ != NULL;
+}
+
+JSONDecoder& JSONDecoder::setPadded(bool padded) {
+    padded_ = padded;
+    return *this;
+}
+
+JSONDecoder& JSONDecoder::setCaseInsensitive(bool case_insensitive) {
+    case_insensitive_ = case_insensitive;
+    return *this;
+}
 
 JSONDecoder& JSONDecoder::setConvertByType(bool convert_by_type) {
     convert_by_type_ = convert_by_type;
     return *this;
 }
 
+JSONDecoder& JSONDecoder::setThreads(uint32_t threads) {
+    threads_ = threads;
+    return *this;
+}
+
 const char* JSONDecoder::getError() const {
     if (!reader_) {
         return "reader is null";
@@ -138,7 +77,7 @@ const char* JSONDecoder::getError() const {
 }
 
 void JSONDecoder::decodeValue(const char* name, bool& value, bool* has_value) {
-    const GenericNode* item = JSONDecoder::getObjectItem(current_, name, case_insensitive_);
+    const TapeNode* item = JSONDecoder::getObjectItem(current_, name, case_insensitive_);
     if (item && checkItemType(*item, json::VALUE_BOOL)) {
         value = item2Bool(*item);
         if (has_value) {
@@ -148,9 +87,12 @@ void JSONDecoder::decodeValue(const char* name, bool& value, bool* has_value) {
 }
 
 void JSONDecoder::decodeValue(const char* name, uint32_t& value, bool* has_value) {
-    const GenericNode* item = JSONDecoder::getObjectItem(current_, name, case_insensitive_);
+    const TapeNode* item = JSONDecoder::getObjectItem(current_, name, case_insensitive_);
     if (item && checkItemType(*item, json::VALUE_NUMBER)) {
-        value = (uint32_t)json::Reader::convertUint(item->value, item->value_size);
+        if (!json::Reader::convertUint(getValue(*item), item->value_size, value)) {
+            reader_->setError("NumberInvalid");
+            return;
+        }
         if (has_value) {
             *has_value = true;
         }
@@ -158,9 +100,12 @@ void JSONDecoder::decodeValue(const char* name, uint32_t& value, bool* has_value
 }
 
 void JSONDecoder::decodeValue(const char* name, int32_t& value, bool* has_value) {
-    const GenericNode* item = JSONDecoder::getObjectItem(current_, name, case_insensitive_);
+    const TapeNode* item = JSONDecoder::getObjectItem(current_, name, case_insensitive_);
     if (item && checkItemType(*item, json::VALUE_NUMBER)) {
-        value = (int32_t)json::Reader::convertInt(item->value, item->value_size);
+        if (!json::Reader::convertInt(getValue(*item), item->value_size, value)) {
+            reader_->setError("NumberInvalid");
+            return;
+        }
         if (has_value) {
             *has_value = true;
         }
@@ -168,9 +113,12 @@ void JSONDecoder::decodeValue(const char* name, int32_t& value, bool* has_value)
 }
 
 void JSONDecoder::decodeValue(const char* name, uint64_t& value, bool* has_value) {
-    const GenericNode* item = JSONDecoder::getObjectItem(current_, name, case_insensitive_);
+    const TapeNode* item = JSONDecoder::getObjectItem(current_, name, case_insensitive_);
     if (item && checkItemType(*item, json::VALUE_NUMBER)) {
-        value = json::Reader::convertUint(item->value, item->value_size);
+        if (!json::Reader::convertUint(getValue(*item), item->value_size, value)) {
+            reader_->setError("NumberInvalid");
+            return;
+        }
         if (has_value) {
             *has_value = true;
         }
@@ -178,9 +126,12 @@ void JSONDecoder::decodeValue(const char* name, uint64_t& value, bool* has_value
 }
 
 void JSONDecoder::decodeValue(const char* name, int64_t& value, bool* has_value) {
-    const GenericNode* item = JSONDecoder::getObjectItem(current_, name, case_insensitive_);
+    const TapeNode* item = JSONDecoder::getObjectItem(current_, name, case_insensitive_);
     if (item && checkItemType(*item, json::VALUE_NUMBER)) {
-        value = json::Reader::convertInt(item->value, item->value_size);
+        if (!json::Reader::convertInt(getValue(*item), item->value_size, value)) {
+            reader_->setError("NumberInvalid");
+            return;
+        }
         if (has_value) {
             *has_value = true;
         }
@@ -188,9 +139,12 @@ void JSONDecoder::decodeValue(const char* name, int64_t& value, bool* has_value)
 }
 
 void JSONDecoder::decodeValue(const char* name, float& value, bool* has_value) {
-    const GenericNode* item = JSONDecoder::getObjectItem(current_, name, case_insensitive_);
+    const TapeNode* item = JSONDecoder::getObjectItem(current_, name, case_insensitive_);
     if (item && checkItemType(*item, json::VALUE_NUMBER)) {
-        value = (float)json::Reader::convertDouble(item->value, item->value_size);
+        if (!json::Reader::convertFloat(getValue(*item), item->value_size, value)) {
+            reader_->setError("NumberInvalid");
+            return;
+        }
         if (has_value) {
             *has_value = true;
         }
@@ -198,9 +152,12 @@ void JSONDecoder::decodeValue(const char* name, float& value, bool* has_value) {
 }
 
 void JSONDecoder::decodeValue(const char* name, double& value, bool* has_value) {
-    const GenericNode* item = JSONDecoder::getObjectItem(current_, name, case_insensitive_);
+    const TapeNode* item = JSONDecoder::getObjectItem(current_, name, case_insensitive_);
     if (item && checkItemType(*item, json::VALUE_NUMBER)) {
-        value = json::Reader::convertDouble(item->value, item->value_size);
+        if (!json::Reader::convertDouble(getValue(*item), item->value_size, value)) {
+            reader_->setError("NumberInvalid");
+            return;
+        }
         if (has_value) {
             *has_value = true;
         }
@@ -208,10 +165,11 @@ void JSONDecoder::decodeValue(const char* name, double& value, bool* has_value)
 }
 
 void JSONDecoder::decodeValue(const char* name, std::string& value, bool* has_value) {
-    const GenericNode* item = JSONDecoder::getObjectItem(current_, name, case_insensitive_);
-    if (item && checkItemType(*item, json::VALUE_STRING) && item->value && item->value_size) {
+    const TapeNode* item = JSONDecoder::getObjectItem(current_, name, case_insensitive_);
+    if (item && checkItemType(*item, json::VALUE_STRING) && item->value_size) {
         value.clear();
-        bool result = parse_string(value, item->value, item->value_size);
+        bool result = json::Reader::convertString(getValue(*item), item->value_size, value);
+        (void)result;
         if (has_value) {
             *has_value = true;
         }
@@ -219,11 +177,23 @@ void JSONDecoder::decodeValue(const char* name, std::string& value, bool* has_va
     }
 }
 
+void JSONDecoder::decodeValue(const char* name, StringRef& value, bool* has_value) {
+    const TapeNode* item = JSONDecoder::getObjectItem(current_, name, case_insensitive_);
+    if (item && checkItemType(*item, json::VALUE_STRING) && item->value_size) {
+        json::Reader::convertString(getValue(*item), item->value_size, reader_->getScratch(),
+                                    value);
+        if (has_value) {
+            *has_value = true;
+        }
+    }
+}
+
 void JSONDecoder::decodeValue(const char* name, std::vector<bool>& value, bool* has_value) {
-    const GenericNode* item = JSONDecoder::getObjectItem(current_, name, case_insensitive_);
+    const TapeNode* item = JSONDecoder::getObjectItem(current_, name, case_insensitive_);
     if (item && checkItemType(*item, json::VALUE_ARRAY)) {
-        for (const GenericNode* child = item->child;
-             child && checkItemType(*item, json::VALUE_BOOL); child = child->next) {
+        value.reserve(value.size() + item->childCount());
+        for (const TapeNode* child = item->child();
+             child && checkItemType(*child, json::VALUE_BOOL); child = child->next()) {
             value.push_back(item2Bool(*child));
             if (has_value) {
                 *has_value = true;
@@ -232,23 +202,99 @@ void JSONDecoder::decodeValue(const char* name, std::vector<bool>& value, bool*
     }
 }
 
-bool JSONDecoder::checkItemType(const GenericNode& item, const int type) const {
-    if (!convert_by_type_ && item.type != json::VALUE_NULL) {
-        return true;
+static bool convertNumber(const char* text, uint32_t size, uint32_t& value) {
+    return json::Reader::convertUint(text, size, value);
+}
+
+static bool convertNumber(const char* text, uint32_t size, int32_t& value) {
+    return json::Reader::convertInt(text, size, value);
+}
+
+static bool convertNumber(const char* text, uint32_t size, uint64_t& value) {
+    return json::Reader::convertUint(text, size, value);
+}
+
+static bool convertNumber(const char* text, uint32_t size, int64_t& value) {
+    return json::Reader::convertInt(text, size, value);
+}
+
+static bool convertNumber(const char* text, uint32_t size, float& value) {
+    return json::Reader::convertFloat(text, size, value);
+}
+
+static bool convertNumber(const char* text, uint32_t size, double& value) {
+    return json::Reader::convertDouble(text, size, value);
+}
+
+template <typename T>
+void JSONDecoder::decodeNumbers(const char* name, std::vector<T>& value, bool* has_value) {
+    const TapeNode* item = JSONDecoder::getObjectItem(current_, name, case_insensitive_);
+    if (!item) {
+        return;
+    }
+    const uint32_t size = item->childCount();
+    if (size) {
+        value.resize(size);
+        const char* src = reader_->getSource();
+        T* data = &value[0];
+        uint32_t idx = 0;
+        for (const TapeNode* child = item->child(); child && idx < size;
+             child = child->next(), ++idx) {
+            if (child->type() == json::VALUE_NUMBER || checkItemType(*child, json::VALUE_NUMBER)) {
+                if (!convertNumber(src + child->value, child->value_size, data[idx])) {
+                    reader_->setError("NumberInvalid");
+                }
+            }
+        }
     }
-    return (item.type == type);
+    if (has_value) {
+        *has_value = true;
+    }
+}
+
+void JSONDecoder::decodeValue(const char* name, std::vector<uint32_t>& value, bool* has_value) {
+    decodeNumbers(name, value, has_value);
 }
 
-bool JSONDecoder::item2Bool(const GenericNode& item) const {
-    if (item.type == json::VALUE_BOOL) {
+void JSONDecoder::decodeValue(const char* name, std::vector<int32_t>& value, bool* has_value) {
+    decodeNumbers(name, value, has_value);
+}
+
+void JSONDecoder::decodeValue(const char* name, std::vector<uint64_t>& value, bool* has_value) {
+    decodeNumbers(name, value, has_value);
+}
+
+void JSONDecoder::decodeValue(const char* name, std::vector<int64_t>& value, bool* has_value) {
+    decodeNumbers(name, value, has_value);
+}
+
+void JSONDecoder::decodeValue(const char* name, std::vector<float>& value, bool* has_value) {
+    decodeNumbers(name, value, has_value);
+}
+
+void JSONDecoder::decodeValue(const char* name, std::vector<double>& value, bool* has_value) {
+    decodeNumbers(name, value, has_value);
+}
+
+bool JSONDecoder::checkItemType(const TapeNode& item, const int type) const {
+    if (!convert_by_type_ && item.type() != json::VALUE_NULL) {
+        // containers have no text to convert
+        return !item.isContainer() || item.type() == type;
+    }
+    return (item.type() == type);
+}
+
+bool JSONDecoder::item2Bool(const TapeNode& item) const {
+    if (item.type() == json::VALUE_BOOL) {
         return (item.value_size == 4);
     } else if (!convert_by_type_) {
-        if (item.type == json::VALUE_NUMBER) {
-            int64_t value = json::Reader::convertInt(item.value, item.value_size);
-            return (value != 0);
-        } else if (item.type == json::VALUE_STRING) {
+        if (item.type() == json::VALUE_NUMBER) {
+            double value = 0.0;
+            return json::Reader::convertDouble(getValue(item), item.value_size, value) &&
+                   value != 0;
+        } else if (item.type() == json::VALUE_STRING) {
             std::string value;
-            if (parse_string(value, item.value, item.value_size)) {
+            if (json::Reader::convertString(getValue(item), item.value_size, value)) {
                 return (atoi(value.c_str()));
             }
         } else {
@@ -258,73 +304,104 @@ bool JSONDecoder::item2Bool(const GenericNode& item) const {
     return false;
 }
 
-uint32_t JSONDecoder::getObjectSize(const GenericNode* parent) {
-    uint32_t size = 0;
+uint32_t JSONDecoder::getObjectSize(const TapeNode* parent) {
     if (parent) {
-        for (const GenericNode* child = parent->child; child; child = child->next) {
-            ++size;
-        }
+        return parent->childCount();
     }
-    return size;
-}
-
-static int32_t strcasecmp(const char* s1, const char* s2) {
-    if (!s1) return (s1 == s2) ? 0 : 1;
-    if (!s2) return 1;
-    for (; tolower(*s1) == tolower(*s2); ++s1, ++s2)
-        if (*s1 == 0) return 0;
-    return tolower(*(const unsigned char*)s1) - tolower(*(const unsigned char*)s2);
+    return 0;
 }
 
-const GenericNode* JSONDecoder::getObjectItem(const GenericNode* parent, const char* name,
-                                              bool case_insensitive) {
+const TapeNode* JSONDecoder::getObjectItem(const TapeNode* parent, const char* name,
+                                           bool case_insensitive) const {
     if (!parent || !name) {
         return parent;
     }
 
-    for (GenericNode* child = parent->child; child; child = child->next) {
-        if (child->key && (strlen(name) == child->key_size)) {
-            if (!case_insensitive) {
-                if (strncmp(name, child->key, child->key_size) == 0) {
-                    return child;
-                }
-            } else {
-                if (strcasecmp(name, std::string(child->key, child->key_size).c_str()) == 0) {
-                    return child;
-                }
+    const char* src = reader_->getSource();
+    const uint32_t name_size = (uint32_t)strlen(name);
+    if (!name_size) {
+        // array elements and text nodes have no key either
+        return NULL;
+    }
+    ShapeCache& shapes = reader_->getShapes();
+    const TapeNode* item = shapes.predict(parent);
+    if (item && item->keySize() == name_size &&
+        KeyIndex::equal(src + item->key, name, name_size, case_insensitive)) {
+        shapes.hit(item);
+        return item;
+    }
+
+    item = NULL;
+    if (parent->childCount() >= KeyIndex::MIN_CHILDREN) {
+        item = reader_->findKey(parent, name, name_size, case_insensitive);
+    } else {
+        for (const TapeNode* child = parent->child(); child; child = child->next()) {
+            if (child->keySize() == name_size &&
+                KeyIndex::equal(src + child->key, name, name_size, case_insensitive)) {
+                item = child;
+                break;
             }
         }
     }
+    shapes.bind(parent, item);
+    return item;
+}
 
-    return NULL;
+JSONDecoder* const* JSONDecoder::getWorkers() {
+    while (workers_.size() < threads_) {
+        JSONDecoder* worker = new JSONDecoder();
+        worker->reader_->attach(*reader_);
+        workers_.push_back(worker);
+    }
+    for (size_t idx = 0; idx < workers_.size(); ++idx) {
+        workers_[idx]->convert_by_type_ = convert_by_type_;
+        workers_[idx]->case_insensitive_ = case_insensitive_;
+    }
+    return &workers_[0];
 }
 
-const GenericNode* JSONDecoder::getChild(const GenericNode* parent) {
+void JSONDecoder::clearError() { reader_->setError(""); }
+
+void JSONDecoder::setItemError(const char* error, size_t idx) {
+    char item[32];
+    snprintf(item, sizeof(item), " at item %lu", (unsigned long)idx);
+    reader_->setError((std::string(error) + item).c_str());
+}
+
+void JSONDecoder::enterShape(const void* type) { reader_->getShapes().enter(type, current_); }
+
+void JSONDecoder::leaveShape() { reader_->getShapes().leave(); }
+
+const TapeNode* JSONDecoder::getChild(const TapeNode* parent) {
     if (parent) {
-        return parent->child;
+        return parent->child();
     }
     return NULL;
 }
 
-const GenericNode* JSONDecoder::getNext(const GenericNode* parent) {
+const TapeNode* JSONDecoder::getNext(const TapeNode* parent) {
     if (parent) {
-        return parent->next;
+        return parent->next();
     }
     return NULL;
 }
 
-const char* JSONDecoder::getKey(const GenericNode* parent) {
+const char* JSONDecoder::getKey(const TapeNode* parent) const {
     if (parent) {
-        return parent->key;
+        return reader_->getSource() + parent->key;
     }
     return NULL;
 }
 
-uint32_t JSONDecoder::getKeySize(const GenericNode* parent) {
+uint32_t JSONDecoder::getKeySize(const TapeNode* parent) {
     if (parent) {
-        return parent->key_size;
+        return parent->keySize();
     }
     return 0;
 }
 
+const char* JSONDecoder::getValue(const TapeNode& item) const {
+    return reader_->getSource() + item.value;
+}
+
 }// namespace serialflex
@@ -0,0 +1,337 @@
+#include <json/direct_reader.h>
+#include <json/reader.h>
+#include <serialflex/json/direct_decoder.h>
+
+namespace serialflex {
+
+JSONDirectDecoder::JSONDirectDecoder()
+    : convert_by_type_(true), case_insensitive_(false), padded_(false), reader_(NULL) {
+    reader_ = new json::DirectReader();
+}
+
+JSONDirectDecoder::JSONDirectDecoder(const char* str, bool case_insensitive)
+    : convert_by_type_(true), case_insensitive_(case_insensitive), padded_(false), reader_(NULL) {
+    reader_ = new json::DirectReader();
+    reset(str);
+}
+
+JSONDirectDecoder::JSONDirectDecoder(const char* data, size_t len, bool case_insensitive)
+    : convert_by_type_(true), case_insensitive_(case_insensitive), padded_(false), reader_(NULL) {
+    reader_ = new json::DirectReader();
+    reset(data, len);
+}
+
+JSONDirectDecoder::~JSONDirectDecoder() { delete reader_; }
+
+bool JSONDirectDecoder::reset(const char* str) { return reset(str, str ? strlen(str) : 0); }
+
+bool JSONDirectDecoder::reset(const char* data, size_t len) {
+    if (!data) {
+        return false;
+    }
+    reader_->reset(data, len, padded_);
+    return (getError() == NULL);
+}
+
+JSONDirectDecoder& JSONDirectDecoder::setPadded(bool padded) {
+    padded_ = padded;
+    return *this;
+}
+
+JSONDirectDecoder& JSONDirectDecoder::setCaseInsensitive(bool case_insensitive) {
+    case_insensitive_ = case_insensitive;
+    return *this;
+}
+
+JSONDirectDecoder& JSONDirectDecoder::setConvertByType(bool convert_by_type) {
+    convert_by_type_ = convert_by_type;
+    return *this;
+}
+
+const char* JSONDirectDecoder::getError() const {
+    if (!reader_) {
+        return "reader is null";
+    }
+    return reader_->getError();
+}
+
+bool JSONDirectDecoder::readValue(bool& value) {
+    int32_t type = json::VALUE_NULL;
+    const char* text = NULL;
+    uint32_t size = 0;
+    if (!readScalar(json::VALUE_BOOL, type, text, size)) {
+        return false;
+    }
+    if (type == json::VALUE_BOOL) {
+        value = (size == 4);
+    } else if (type == json::VALUE_NUMBER) {
+        double number = 0.0;
+        value = json::Reader::convertDouble(text, size, number) && number != 0;
+    } else {
+        std::string str;
+        value = json::Reader::convertString(text, size, str) && atoi(str.c_str());
+    }
+    return true;
+}
+
+bool JSONDirectDecoder::readValue(uint32_t& value) {
+    int32_t type = json::VALUE_NULL;
+    const char* text = NULL;
+    uint32_t size = 0;
+    if (!readScalar(json::VALUE_NUMBER, type, text, size)) {
+        return false;
+    }
+    if (!json::Reader::convertUint(text, size, value)) {
+        reader_->setError("NumberInvalid");
+        return false;
+    }
+    return true;
+}
+
+bool JSONDirectDecoder::readValue(int32_t& value) {
+    int32_t type = json::VALUE_NULL;
+    const char* text = NULL;
+    uint32_t size = 0;
+    if (!readScalar(json::VALUE_NUMBER, type, text, size)) {
+        return false;
+    }
+    if (!json::Reader::convertInt(text, size, value)) {
+        reader_->setError("NumberInvalid");
+        return false;
+    }
+    return true;
+}
+
+bool JSONDirectDecoder::readValue(uint64_t& value) {
+    int32_t type = json::VALUE_NULL;
+    const char* text = NULL;
+    uint32_t size = 0;
+    if (!readScalar(json::VALUE_NUMBER, type, text, size)) {
+        return false;
+    }
+    if (!json::Reader::convertUint(text, size, value)) {
+        reader_->setError("NumberInvalid");
+        return false;
+    }
+    return true;
+}
+
+bool JSONDirectDecoder::readValue(int64_t& value) {
+    int32_t type = json::VALUE_NULL;
+    const char* text = NULL;
+    uint32_t size = 0;
+    if (!readScalar(json::VALUE_NUMBER, type, text, size)) {
+        return false;
+    }
+    if (!json::Reader::convertInt(text, size, value)) {
+        reader_->setError("NumberInvalid");
+        return false;
+    }
+    return true;
+}
+
+bool JSONDirectDecoder::readValue(float& value) {
+    int32_t type = json::VALUE_NULL;
+    const char* text = NULL;
+    uint32_t size = 0;
+    if (!readScalar(json::VALUE_NUMBER, type, text, size)) {
+        return false;
+    }
+    if (!json::Reader::convertFloat(text, size, value)) {
+        reader_->setError("NumberInvalid");
+        return false;
+    }
+    return true;
+}
+
+bool JSONDirectDecoder::readValue(double& value) {
+    int32_t type = json::VALUE_NULL;
+    const char* text = NULL;
+    uint32_t size = 0;
+    if (!readScalar(json::VALUE_NUMBER, type, text, size)) {
+        return false;
+    }
+    if (!json::Reader::convertDouble(text, size, value)) {
+        reader_->setError("NumberInvalid");
+        return false;
+    }
+    return true;
+}
+
+bool JSONDirectDecoder::readValue(std::string& value) {
+    int32_t type = json::VALUE_NULL;
+    const char* text = NULL;
+    uint32_t size = 0;
+    if (!readScalar(json::VALUE_STRING, type, text, size) || !size) {
+        return false;
+    }
+    value.clear();
+    json::Reader::convertString(text, size, value);
+    return true;
+}
+
+bool JSONDirectDecoder::readValue(StringRef& value) {
+    int32_t type = json::VALUE_NULL;
+    const char* text = NULL;
+    uint32_t size = 0;
+    if (!readScalar(json::VALUE_STRING, type, text, size) || !size) {
+        return false;
+    }
+    return json::Reader::convertString(text, size, reader_->getScratch(), value);
+}
+
+bool JSONDirectDecoder::readValue(std::vector<bool>& value) {
+    if (!reader_->enter(json::VALUE_ARRAY)) {
+        reader_->skipValue();
+        return false;
+    }
+    bool has_value = false;
+    bool matching = true;// elements are taken up to the first one that is not a bool
+    while (reader_->nextElement()) {
+        bool item = false;
+        if (!matching) {
+            reader_->skipValue();
+        } else if (readValue(item)) {
+            value.push_back(item);
+            has_value = true;
+        } else {
+            matching = false;
+        }
+    }
+    return has_value;
+}
+
+bool JSONDirectDecoder::begin() {
+    targets_.clear();
+    bound_.clear();
+    return reader_->begin();
+}
+
+const JSONDirectDecoder::Layout* JSONDirectDecoder::findLayout(const void* type) const {
+    std::map<const void*, Layout>::const_iterator it = types_.find(type);
+    if (it == types_.end()) {
+        return NULL;
+    }
+    return &it->second;
+}
+
+void JSONDirectDecoder::readObject(const void* type, const Layout* layout, size_t first,
+                                   uintptr_t base, size_t size) {
+    if (!layout) {
+        // the first object of the type, its fields become offsets when they all lie inside it
+        Layout record = {(uint32_t)layouts_.size(), (uint32_t)(targets_.size() - first), true};
+        for (size_t idx = first; idx < targets_.size() && record.relative; ++idx) {
+            const Target& target = targets_[idx];
+            record.relative = (target.value - base < size) &&
+                              (!target.has || target.has_value - base < size);
+        }
+        if (record.relative) {
+            for (size_t idx = first; idx < targets_.size(); ++idx) {
+                Target target = targets_[idx];
+                target.value -= base;
+                target.has_value -= base;
+                layouts_.push_back(target);
+            }
+            targets_.resize(first);
+        }
+        layout = &types_.insert(std::pair<const void*, Layout>(type, record)).first->second;
+    }
+    if (layout->relative) {
+        readFields(layouts_, layout->first, layout->count, base);
+    } else {
+        readFields(targets_, first, targets_.size() - first, 0);
+        targets_.resize(first);
+    }
+}
+
+void JSONDirectDecoder::readFields(const std::vector<Target>& targets, size_t first,
+                                   size_t count, uintptr_t base) {
+    if (!reader_->enter(json::VALUE_OBJECT)) {
+        reader_->skipValue();
+        return;
+    }
+    const size_t mark = bound_.size();
+    bound_.resize(mark + count, 0);
+    // fields usually arrive in the order of the convert calls
+    size_t hint = 0;
+    const char* key = NULL;
+    uint32_t key_size = 0;
+    while (reader_->nextMember(key, key_size)) {
+        const size_t idx = findTarget(targets, first, count, hint, &bound_[mark], key, key_size,
+                                      case_insensitive_);
+        if (idx == count) {
+            reader_->skipValue();
+            continue;
+        }
+        // nested objects may grow both vectors, copy before the call
+        bound_[mark + idx] = 1;
+        const Target target = targets[first + idx];
+        if (target.read(*this, (void*)(base + target.value)) && target.has) {
+            *(bool*)(base + target.has_value) = true;
+        }
+        hint = idx + 1;
+    }
+    bound_.resize(mark);
+}
+
+size_t JSONDirectDecoder::findTarget(const std::vector<Target>& targets, size_t first,
+                                     size_t count, size_t hint, const uint8_t* bound,
+                                     const char* key, uint32_t key_size, bool case_insensitive) {
+    if (hint < count) {
+        const Target& target = targets[first + hint];
+        if (target.name_size == key_size && !bound[hint] &&
+            KeyIndex::equal(target.name, key, key_size, case_insensitive)) {
+            return hint;
+        }
+    }
+    for (size_t idx = 0; idx < count; ++idx) {
+        const Target& target = targets[first + idx];
+        if (target.name_size == key_size && !bound[idx] &&
+            KeyIndex::equal(target.name, key, key_size, case_insensitive)) {
+            return idx;
+        }
+    }
+    return count;
+}
+
+bool JSONDirectDecoder::enterItems(bool& object) {
+    if (reader_->enter(json::VALUE_ARRAY)) {
+        object = false;
+        return true;
+    }
+    if (reader_->enter(json::VALUE_OBJECT)) {
+        object = true;
+        return true;
+    }
+    reader_->skipValue();
+    return false;
+}
+
+bool JSONDirectDecoder::nextItem(bool object, const char*& key, uint32_t& key_size) {
+    if (object) {
+        return reader_->nextMember(key, key_size);
+    }
+    key = "";
+    key_size = 0;
+    return reader_->nextElement();
+}
+
+void JSONDirectDecoder::skipItem() { reader_->skipValue(); }
+
+bool JSONDirectDecoder::readScalar(int32_t type, int32_t& item_type, const char*& value,
+                                   uint32_t& size) {
+    item_type = reader_->peek();
+    if (item_type == json::VALUE_OBJECT || item_type == json::VALUE_ARRAY || item_type < 0) {
+        reader_->skipValue();
+        return false;
+    }
+    if (!reader_->readScalar(item_type, value, size)) {
+        return false;
+    }
+    if (!convert_by_type_) {
+        return (item_type != json::VALUE_NULL);
+    }
+    return (item_type == type);
+}
+
+}// namespace serialflex
@@ -0,0 +1,236 @@
+#include <string.h>
+#include "direct_reader.h"
+
+namespace serialflex {
+
+namespace json {
+
+DirectReader::DirectReader()
+    : src_(NULL), length_(0), padded_(false), pos_(0), opened_(false), depth_(0) {}
+
+void DirectReader::reset(const char* src, size_t length, bool padded) {
+    src_ = src;
+    length_ = length;
+    padded_ = padded;
+    str_error_.clear();
+    if (length > 0xFFFFFFFFU) {
+        // values are handed out with 32-bit sizes
+        src_ = NULL;
+        setError("DocumentTooLarge");
+    }
+}
+
+bool DirectReader::begin() {
+    if (!src_) {
+        return false;
+    }
+    str_error_.clear();
+    scratch_.clear();
+    indexer_.reset(src_, length_, padded_);
+    advance();
+    opened_ = false;
+    depth_ = 0;
+    return true;
+}
+
+const char* DirectReader::getError() const {
+    if (str_error_.empty()) {
+        return NULL;
+    }
+    return str_error_.c_str();
+}
+
+void DirectReader::setError(const char* error) {
+    if (str_error_.empty()) {
+        str_error_ = error;
+    }
+    pos_ = length_;
+    opened_ = false;
+    depth_ = 0;
+}
+
+bool DirectReader::readScalar(int32_t type, const char*& value, uint32_t& size) {
+    const size_t pos = pos_;
+    switch (type) {
+        case VALUE_NULL:
+            if (!consumeLiteral("null", 4)) {
+                setError("ValueInvalid");
+                return false;
+            }
+            size = 4;
+            break;
+        case VALUE_BOOL: {
+            const bool is_true = (src_[pos] == 't');
+            if (!consumeLiteral(is_true ? "true" : "false", is_true ? 4 : 5)) {
+                setError("ValueInvalid");
+                return false;
+            }
+            size = is_true ? 4 : 5;
+        } break;
+        case VALUE_STRING: {
+            const size_t end = indexer_.next();
+            if (end >= length_ || src_[end] != '\"') {
+                setError("ValueInvalid");
+                return false;
+            }
+            value = src_ + pos + 1;
+            size = (uint32_t)(end - pos - 1);
+            advance();
+            opened_ = false;
+            return true;
+        }
+        case VALUE_NUMBER: {
+            // -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][-+]?[0-9]+)?
+            size_t end = pos;
+            if (src_[end] == '-') {
+                ++end;
+            }
+            if (end < length_ && src_[end] == '0') {
+                ++end;
+            } else {
+                const size_t digits = end;
+                end = skipDigits(end);
+                if (end == digits) {
+                    setError("ValueInvalid");
+                    return false;
+                }
+            }
+            if (end < length_ && src_[end] == '.') {
+                const size_t fraction = ++end;
+                end = skipDigits(end);
+                if (end == fraction) {
+                    setError("ValueInvalid");
+                    return false;
+                }
+            }
+            if (end < length_ && (src_[end] == 'e' || src_[end] == 'E')) {
+                ++end;
+                if (end < length_ && (src_[end] == '-' || src_[end] == '+')) {
+                    ++end;
+                }
+                const size_t exponent = end;
+                end = skipDigits(end);
+                if (end == exponent) {
+                    setError("ValueInvalid");
+                    return false;
+                }
+            }
+            if (!isDelimiter(end)) {
+                setError("ValueInvalid");
+                return false;
+            }
+            size = (uint32_t)(end - pos);
+        } break;
+        default:
+            // a container, or nothing left where a value belongs
+            setError("ValueInvalid");
+            return false;
+    }
+    value = src_ + pos;
+    advance();
+    opened_ = false;
+    return true;
+}
+
+bool DirectReader::nextMember(const char*& key, uint32_t& key_size) {
+    if (pos_ < length_ && src_[pos_] == '}' && depth_) {
+        advance();
+        opened_ = false;
+        --depth_;
+        return false;
+    }
+    if (!opened_) {
+        if (pos_ >= length_ || src_[pos_] != ',') {
+            setError("ObjectMissCommaOrCurlyBracket");
+            return false;
+        }
+        advance();
+    }
+    opened_ = false;
+
+    if (pos_ >= length_ || src_[pos_] != '"') {
+        setError("ObjectMissName");
+        return false;
+    }
+    // the indexer skips escaped quotes, the next structural closes the key
+    const size_t end = indexer_.next();
+    if (end >= length_ || src_[end] != '\"') {
+        setError("KeyInvalid");
+        return false;
+    }
+    key = src_ + pos_ + 1;
+    key_size = (uint32_t)(end - pos_ - 1);
+
+    advance();
+    if (pos_ >= length_ || src_[pos_] != ':') {
+        setError("ObjectMissColon");
+        return false;
+    }
+    advance();
+    return true;
+}
+
+void DirectReader::skipValue() {
+    if (pos_ >= length_) {
+        if (depth_) {
+            setError("ValueInvalid");
+        }
+        return;
+    }
+    const char c = src_[pos_];
+    if (c == '{' || c == '[') {
+        uint32_t depth = 0;
+        do {
+            const char token = src_[pos_];
+            if (token == '{' || token == '[') {
+                ++depth;
+            } else if (token == '}' || token == ']') {
+                --depth;
+            }
+            advance();
+        } while (depth && pos_ < length_);
+        if (depth) {
+            setError("ValueInvalid");
+            return;
+        }
+    } else if (c == '"') {
+        const size_t end = indexer_.next();
+        if (end >= length_ || src_[end] != '\"') {
+            setError("ValueInvalid");
+            return;
+        }
+        advance();
+    } else if (StructuralIndexer::isOperator(c)) {
+        setError("ValueInvalid");
+        return;
+    } else {
+        // numbers and literals of skipped values are not validated
+        advance();
+    }
+    opened_ = false;
+}
+
+bool DirectReader::consumeLiteral(const char* literal, const uint32_t literal_size) const {
+    if (length_ - pos_ < literal_size || memcmp(src_ + pos_, literal, literal_size) != 0) {
+        return false;
+    }
+    return isDelimiter(pos_ + literal_size);
+}
+
+size_t DirectReader::skipDigits(size_t pos) const {
+    while (pos < length_ && '0' <= src_[pos] && src_[pos] <= '9') {
+        ++pos;
+    }
+    return pos;
+}
+
+bool DirectReader::isDelimiter(const size_t pos) const {
+    if (pos >= length_) {
+        return true;
+    }
+    return StructuralIndexer::isWhitespace(src_[pos]) || StructuralIndexer::isOperator(src_[pos]);
+}
+
+}// namespace json
+
+}// namespace serialflex
@@ -0,0 +1,115 @@
+#ifndef __JSON_DIRECT_READER_H__
+#define __JSON_DIRECT_READER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include "indexer.h"
+#include "reader.h"
+#include "scratch.h"
+
+namespace serialflex {
+
+namespace json {
+
+// Pull-style cursor over the structural index for the direct decoder. Values are consumed
+// in document order and never stored: scalars are handed out as offsets into the source,
+// containers are stepped into or skipped by bracket depth without looking inside them.
+class DirectReader {
+    StructuralIndexer indexer_;
+    const char* src_;
+    size_t length_;
+    bool padded_;
+    size_t pos_;    // offset of the next structural character, length_ at the end
+    bool opened_;   // a container was just entered, its first value needs no ','
+    uint32_t depth_;// containers entered and not closed yet
+    Scratch scratch_;
+    std::string str_error_;
+
+    DirectReader(const DirectReader&);
+    DirectReader& operator=(const DirectReader&);
+
+public:
+    DirectReader();
+    ~DirectReader() {}
+
+    // padded: at least INPUT_PADDING readable bytes follow src + length
+    void reset(const char* src, size_t length, bool padded);
+    // start reading the document from its first value
+    bool begin();
+
+    const char* getError() const;
+    // keeps the first error and stops the walk
+    void setError(const char* error);
+    // unescaped text of StringRef fields, valid until the next begin
+    Scratch& getScratch() { return scratch_; }
+
+    // type of the value at the cursor, -1 at the end of the input
+    int32_t peek() const {
+        if (pos_ >= length_) {
+            return -1;
+        }
+        switch (src_[pos_]) {
+            case 'n':
+                return VALUE_NULL;
+            case 't':
+            case 'f':
+                return VALUE_BOOL;
+            case '"':
+                return VALUE_STRING;
+            case '[':
+                return VALUE_ARRAY;
+            case '{':
+                return VALUE_OBJECT;
+            default:
+                return VALUE_NUMBER;
+        }
+    }
+    // consumes the scalar of the type peek() returned, value and size as the tape keeps them
+    bool readScalar(int32_t type, const char*& value, uint32_t& size);
+    // steps into the container of that type at the cursor, false for anything else
+    bool enter(int32_t type) {
+        if (pos_ >= length_ || src_[pos_] != (type == VALUE_OBJECT ? '{' : '[')) {
+            return false;
+        }
+        advance();
+        opened_ = true;
+        ++depth_;
+        return true;
+    }
+    // next member of the entered object, false once it is closed
+    bool nextMember(const char*& key, uint32_t& key_size);
+    // next element of the entered array, false once it is closed
+    bool nextElement() {
+        if (pos_ < length_ && src_[pos_] == ']' && depth_) {
+            advance();
+            opened_ = false;
+            --depth_;
+            return false;
+        }
+        if (opened_) {
+            opened_ = false;
+            return true;
+        }
+        if (pos_ >= length_ || src_[pos_] != ',') {
+            setError("ParseErrorArrayMissCommaOrSquareBracket");
+            return false;
+        }
+        advance();
+        return true;
+    }
+    // consumes the value at the cursor, containers only by bracket depth
+    void skipValue();
+
+private:
+    void advance() { pos_ = indexer_.next(); }
+    bool consumeLiteral(const char* literal, const uint32_t literal_size) const;
+    size_t skipDigits(size_t pos) const;
+    bool isDelimiter(const size_t pos) const;
+};
+
+}// namespace json
+
+}// namespace serialflex
+
+#endif
@@ -3,10 +3,16 @@
 
 namespace serialflex {
 
-JSONEncoder::JSONEncoder(std::string& str, bool formatted) {
+JSONEncoder::JSONEncoder(std::string& str, bool formatted)
+    : formatted_(formatted), presize_(false), threads_(1) {
     writer_ = new json::Writer(str, formatted);
 }
 
+JSONEncoder::JSONEncoder(OutputSink& sink, bool formatted)
+    : formatted_(formatted), presize_(false), threads_(1) {
+    writer_ = new json::Writer(sink, formatted);
+}
+
 JSONEncoder::~JSONEncoder() { delete writer_; }
 
 void JSONEncoder::encodeValue(const char* name, const bool& value) {
@@ -53,7 +59,13 @@ void JSONEncoder::encodeValue(const char* name, const double& value) {
 
 void JSONEncoder::encodeValue(const char* name, const std::string& value) {
     if (writer_) {
-        writer_->key(name).value(value.c_str());
+        writer_->key(name).value(value.data(), value.size());
+    }
+}
+
+void JSONEncoder::encodeValue(const char* name, const StringRef& value) {
+    if (writer_) {
+        writer_->key(name).value(value.data(), value.size());
     }
 }
 
@@ -98,10 +110,29 @@ bool JSONEncoder::writerResult() const {
     return false;
 }
 
+void JSONEncoder::writerExpect(size_t size) {
+    if (writer_) {
+        writer_->expect(size);
+    }
+}
+
 void JSONEncoder::writerSeparation() {
     if (writer_) {
         writer_->separation();
     }
 }
 
+size_t JSONEncoder::writerSize() const {
+    if (writer_) {
+        return writer_->size();
+    }
+    return 0;
+}
+
+void JSONEncoder::writerWrite(const char* data, size_t size) {
+    if (writer_) {
+        writer_->write(data, size);
+    }
+}
+
 }// namespace serialflex
@@ -0,0 +1,177 @@
+#include <string.h>
+#include "indexer.h"
+
+namespace serialflex {
+
+namespace json {
+
+static const uint64_t kEvenBits = 0x5555555555555555ULL;
+
+// bits of the characters preceded by an odd number of backslashes
+static inline uint64_t findEscaped(uint64_t backslash, uint64_t& prev_escaped) {
+    backslash &= ~prev_escaped;
+    const uint64_t follows_escape = (backslash << 1) | prev_escaped;
+    // sequences starting on odd bits overflow into the bit after their end
+    const uint64_t odd_sequence_starts = backslash & ~kEvenBits & ~follows_escape;
+    const uint64_t sequences_starting_on_even_bits = odd_sequence_starts + backslash;
+    prev_escaped = (sequences_starting_on_even_bits < odd_sequence_starts) ? 1 : 0;
+    const uint64_t invert_mask = sequences_starting_on_even_bits << 1;
+    return (kEvenBits ^ invert_mask) & follows_escape;
+}
+
+// bit i is the xor of bits 0..i: set from an opening quote up to the closing one
+static inline uint64_t prefixXor(uint64_t bits) {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+StructuralIndexer::StructuralIndexer()
+    : src_(NULL), length_(0), padded_(false), next_block_(0), base_(0), bits_(0), prev_escaped_(0),
+      prev_in_string_(0), prev_scalar_(0), classify_(&StructuralIndexer::classifyScalar) {
+#ifdef SERIALFLEX_SSE2
+    classify_ = &StructuralIndexer::classifySSE2;
+#endif
+#ifdef SERIALFLEX_AVX2
+    if (simd::hasAVX2()) {
+        classify_ = &StructuralIndexer::classifyAVX2;
+    }
+#endif
+}
+
+void StructuralIndexer::reset(const char* src, size_t length, bool padded) {
+    src_ = src;
+    length_ = length;
+    padded_ = padded;
+    next_block_ = 0;
+    base_ = 0;
+    bits_ = 0;
+    prev_escaped_ = 0;
+    prev_in_string_ = 0;
+    prev_scalar_ = 0;
+}
+
+void StructuralIndexer::indexBlock() {
+    const char* block = src_ + next_block_;
+    const size_t remaining = length_ - next_block_;
+    char tail[64];
+    if (remaining < sizeof(tail) && !padded_) {
+        // pad the last block with whitespace, which never produces a structural
+        memset(tail, ' ', sizeof(tail));
+        memcpy(tail, block, remaining);
+        block = tail;
+    }
+
+    BlockMasks masks;
+    classify_(block, masks);
+
+    const uint64_t escaped = findEscaped(masks.backslash, prev_escaped_);
+    const uint64_t quote = masks.quote & ~escaped;
+    const uint64_t in_string = prefixXor(quote) ^ prev_in_string_;
+    prev_in_string_ = (uint64_t)((int64_t)in_string >> 63);
+    // string contents and closing quotes
+    const uint64_t string_tail = in_string ^ quote;
+
+    const uint64_t scalar = ~(masks.op | masks.whitespace);
+    const uint64_t nonquote_scalar = scalar & ~quote;
+    const uint64_t follows_nonquote_scalar = (nonquote_scalar << 1) | prev_scalar_;
+    prev_scalar_ = nonquote_scalar >> 63;
+    const uint64_t scalar_start = scalar & ~follows_nonquote_scalar;
+
+    bits_ = ((masks.op | scalar_start) & ~string_tail) | quote;
+    if (remaining < sizeof(tail)) {
+        // padding read in place may hold anything
+        bits_ &= (1ULL << remaining) - 1;
+    }
+    base_ = next_block_;
+    next_block_ += sizeof(tail);
+}
+
+void StructuralIndexer::classifyScalar(const char* block, BlockMasks& masks) {
+    masks.quote = 0;
+    masks.backslash = 0;
+    masks.op = 0;
+    masks.whitespace = 0;
+    for (uint32_t idx = 0; idx < 64; ++idx) {
+        const char c = block[idx];
+        const uint64_t bit = 1ULL << idx;
+        if (c == '"') {
+            masks.quote |= bit;
+        } else if (c == '\\') {
+            masks.backslash |= bit;
+        } else if (isOperator(c)) {
+            masks.op |= bit;
+        } else if (isWhitespace(c)) {
+            masks.whitespace |= bit;
+        }
+    }
+}
+
+#ifdef SERIALFLEX_SSE2
+void StructuralIndexer::classifySSE2(const char* block, BlockMasks& masks) {
+    masks.quote = 0;
+    masks.backslash = 0;
+    masks.op = 0;
+    masks.whitespace = 0;
+    for (uint32_t idx = 0; idx < 64; idx += 16) {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(block + idx));
+        // '[' and ']' differ from '{' and '}' only in bit 0x20
+        const __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        const __m128i op = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(lower, _mm_set1_epi8('{')),
+                         _mm_cmpeq_epi8(lower, _mm_set1_epi8('}'))),
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(':')),
+                         _mm_cmpeq_epi8(v, _mm_set1_epi8(','))));
+        const __m128i whitespace = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                         _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))),
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')),
+                         _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))));
+        masks.quote |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')))
+                       << idx;
+        masks.backslash |=
+            (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))) << idx;
+        masks.op |= (uint64_t)(uint32_t)_mm_movemask_epi8(op) << idx;
+        masks.whitespace |= (uint64_t)(uint32_t)_mm_movemask_epi8(whitespace) << idx;
+    }
+}
+#endif
+
+#ifdef SERIALFLEX_AVX2
+SERIALFLEX_TARGET_AVX2 void StructuralIndexer::classifyAVX2(const char* block, BlockMasks& masks) {
+    masks.quote = 0;
+    masks.backslash = 0;
+    masks.op = 0;
+    masks.whitespace = 0;
+    for (uint32_t idx = 0; idx < 64; idx += 32) {
+        const __m256i v = _mm256_loadu_si256((const __m256i*)(block + idx));
+        const __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        const __m256i op = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(lower, _mm256_set1_epi8('{')),
+                            _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('}'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(':')),
+                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8(','))));
+        const __m256i whitespace = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')),
+                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))));
+        masks.quote |=
+            (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')))
+            << idx;
+        masks.backslash |=
+            (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')))
+            << idx;
+        masks.op |= (uint64_t)(uint32_t)_mm256_movemask_epi8(op) << idx;
+        masks.whitespace |= (uint64_t)(uint32_t)_mm256_movemask_epi8(whitespace) << idx;
+    }
+}
+#endif
+
+}// namespace json
+
+}// namespace serialflex
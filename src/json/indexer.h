@@ -0,0 +1,81 @@
+#ifndef __JSON_INDEXER_H__
+#define __JSON_INDEXER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "simd.h"
+
+namespace serialflex {
+
+namespace json {
+
+// Character classes of one 64-byte block, bit i describes byte i.
+struct BlockMasks {
+    uint64_t quote;
+    uint64_t backslash;
+    uint64_t op;// '{' '}' '[' ']' ':' ','
+    uint64_t whitespace;
+};
+
+// Stage one of the reader: classifies the input a block at a time and hands out the offsets
+// of structural characters (operators, both quotes of every string and the first byte of
+// every other scalar) in document order. Escaped quotes and anything inside strings never
+// show up, so the parser jumps from token to token instead of looking at every byte.
+class StructuralIndexer {
+    typedef void (*Classify)(const char* block, BlockMasks& masks);
+
+    const char* src_;
+    size_t length_;
+    bool padded_;// the last block may be loaded in place
+    size_t next_block_;// offset of the next block to classify
+    size_t base_;      // offset of the block in bits_
+    uint64_t bits_;    // structurals of the current block not handed out yet
+
+    // carries between blocks
+    uint64_t prev_escaped_;
+    uint64_t prev_in_string_;
+    uint64_t prev_scalar_;
+
+    Classify classify_;
+
+public:
+    StructuralIndexer();
+    void reset(const char* src, size_t length, bool padded);
+
+    // offset of the next structural character, length when the input is exhausted
+    size_t next() {
+        while (!bits_) {
+            if (next_block_ >= length_) {
+                return length_;
+            }
+            indexBlock();
+        }
+        const size_t pos = base_ + simd::trailingZeros(bits_);
+        bits_ &= bits_ - 1;
+        return pos;
+    }
+
+    static bool isWhitespace(const char c) {
+        return (c == ' ' || c == '\n' || c == '\r' || c == '\t');
+    }
+    static bool isOperator(const char c) {
+        return (c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',');
+    }
+
+private:
+    void indexBlock();
+
+    static void classifyScalar(const char* block, BlockMasks& masks);
+#ifdef SERIALFLEX_SSE2
+    static void classifySSE2(const char* block, BlockMasks& masks);
+#endif
+#ifdef SERIALFLEX_AVX2
+    SERIALFLEX_TARGET_AVX2 static void classifyAVX2(const char* block, BlockMasks& masks);
+#endif
+};
+
+}// namespace json
+
+}// namespace serialflex
+
+#endif
@@ -1,118 +1,208 @@
 #include <assert.h>
 #include "reader.h"
+#include "../number/reader.h"
 
 namespace serialflex {
 
 namespace json {
 
-class StringStream {
-    const char* src_;
-
-public:
-    typedef const char value_type;
-    explicit StringStream(const char* src): src_(src) {}
-    value_type Peek() const {
-        if (isEnd()) {
-            return '\0';
-        }
-        return *src_;
-    }
-    value_type Second2Last() const { return *(src_ - 1); }
-    value_type Take() { return *src_++; }
-    value_type* Strart() const { return src_; }
-    bool isEnd() const { return (*src_ == '\0'); }
-};
-
 /*------------------------------------------------------------------------------*/
 
-Reader::Reader(): cur_value_(NULL), alloc_(values_) {}
+Reader::Reader(): cur_(0), src_(NULL), length_(0), document_(this) {}
 
 Reader::~Reader() {}
 
-int64_t Reader::convertInt(const char* value, uint32_t length) {
-    if (!length) {
-        return 0;
-    }
+bool Reader::convertInt(const char* value, uint32_t length, int32_t& result) {
+    return number::parseInt32(value, length, result);
+}
 
-    int64_t result = 0;
-    bool bMinus = false;
-    if (value[0] == '-') {
-        bMinus = true;
-    }
-    for (uint32_t idx = bMinus; idx < length; ++idx) {
-        result *= 10;
-        result += value[idx] - '0';
+bool Reader::convertInt(const char* value, uint32_t length, int64_t& result) {
+    return number::parseInt64(value, length, result);
+}
+
+bool Reader::convertUint(const char* value, uint32_t length, uint32_t& result) {
+    return number::parseUint32(value, length, result);
+}
+
+bool Reader::convertUint(const char* value, uint32_t length, uint64_t& result) {
+    return number::parseUint64(value, length, result);
+}
+
+bool Reader::convertDouble(const char* value, uint32_t length, double& result) {
+    return number::parseDouble(value, length, result);
+}
+
+bool Reader::convertFloat(const char* value, uint32_t length, float& result) {
+    return number::parseFloat(value, length, result);
+}
+
+// offset of the first backslash in str[pos, length), length when there is none
+static uint32_t findEscape(const char* str, uint32_t pos, uint32_t length) {
+#ifdef SERIALFLEX_SSE2
+    const __m128i backslash = _mm_set1_epi8('\\');
+    for (; length - pos >= 16; pos += 16) {
+        const __m128i block = _mm_loadu_si128((const __m128i*)(str + pos));
+        const uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block, backslash));
+        if (mask) {
+            return pos + simd::trailingZeros(mask);
+        }
     }
-    if (bMinus) {
-        result = 0 - result;
+#endif
+    while (pos < length && str[pos] != '\\') {
+        ++pos;
     }
-    return result;
+    return pos;
 }
 
-uint64_t Reader::convertUint(const char* value, uint32_t length) {
-    if (!length) {
-        return 0;
+static bool parseHex4(const char* str, uint32_t& value) {
+    value = 0;
+    for (uint32_t idx = 0; idx < 4; ++idx) {
+        const char c = str[idx];
+        value <<= 4;
+        if (c >= '0' && c <= '9') {
+            value |= (uint32_t)(c - '0');
+        } else if (c >= 'A' && c <= 'F') {
+            value |= (uint32_t)(c - 'A' + 10);
+        } else if (c >= 'a' && c <= 'f') {
+            value |= (uint32_t)(c - 'a' + 10);
+        } else {
+            return false;
+        }
     }
+    return true;
+}
 
-    uint64_t result = 0;
-    for (uint32_t idx = 0; idx < length; ++idx) {
-        result *= 10;
-        result += value[idx] - '0';
+static void appendUTF8(uint32_t code, std::string& result) {
+    char buffer[4];
+    uint32_t size = 0;
+    if (code < 0x80) {
+        buffer[size++] = (char)code;
+    } else if (code < 0x800) {
+        buffer[size++] = (char)(0xC0 | (code >> 6));
+        buffer[size++] = (char)(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+        buffer[size++] = (char)(0xE0 | (code >> 12));
+        buffer[size++] = (char)(0x80 | ((code >> 6) & 0x3F));
+        buffer[size++] = (char)(0x80 | (code & 0x3F));
+    } else {
+        buffer[size++] = (char)(0xF0 | (code >> 18));
+        buffer[size++] = (char)(0x80 | ((code >> 12) & 0x3F));
+        buffer[size++] = (char)(0x80 | ((code >> 6) & 0x3F));
+        buffer[size++] = (char)(0x80 | (code & 0x3F));
     }
-    return result;
+    result.append(buffer, size);
 }
 
-static inline double decimal(uint8_t n, uint32_t num) {
-    double db = n * 1.0f;
-    while (num--) {
-        db = db / 10;
+// transcodes the utf-16 escape whose hex digits start at pos, returns the offset after it.
+// malformed escapes and unpaired surrogates are dropped
+static uint32_t appendUnicode(const char* str, uint32_t pos, uint32_t length,
+                              std::string& result) {
+    uint32_t code = 0;
+    if (length - pos < 4 || !parseHex4(str + pos, code)) {
+        return pos;
+    }
+    pos += 4;
+    if (code >= 0xDC00 && code <= 0xDFFF) {
+        return pos;
     }
-    return db;
+    if (code >= 0xD800 && code <= 0xDBFF) {
+        uint32_t low = 0;
+        if (length - pos < 6 || str[pos] != '\\' || str[pos + 1] != 'u' ||
+            !parseHex4(str + pos + 2, low) || low < 0xDC00 || low > 0xDFFF) {
+            return pos;
+        }
+        pos += 6;
+        code = 0x10000 + (((code & 0x3FF) << 10) | (low & 0x3FF));
+    }
+    appendUTF8(code, result);
+    return pos;
 }
 
-double Reader::convertDouble(const char* value, uint32_t length) {
+bool Reader::convertString(const char* str, uint32_t length, std::string& strValue) {
     if (!length) {
-        return 0.0f;
+        return false;
+    } /* not a string! */
+    // escapes never grow the text, one reservation covers the whole value
+    strValue.reserve(strValue.size() + length);
+    uint32_t pos = 0;
+    while (pos < length) {
+        // copy the clean run up to the next escape in one go
+        const uint32_t escape = findEscape(str, pos, length);
+        strValue.append(str + pos, escape - pos);
+        if (length - escape < 2) {
+            break;
+        }
+        pos = escape + 2;
+        switch (str[escape + 1]) {
+            case 'b':
+                strValue.append(1, '\b');
+                break;
+            case 'f':
+                strValue.append(1, '\f');
+                break;
+            case 'n':
+                strValue.append(1, '\n');
+                break;
+            case 'r':
+                strValue.append(1, '\r');
+                break;
+            case 't':
+                strValue.append(1, '\t');
+                break;
+            case 'u':
+                pos = appendUnicode(str, pos, length, strValue);
+                break;
+            default:
+                strValue.append(1, str[escape + 1]);
+                break;
+        }
     }
+    return true;
+}
 
-    unsigned char* after_end = NULL;
-    unsigned char number_c_string[64] = {0};
-
-    for (uint32_t idx = 0; idx < length; ++idx) {
-        number_c_string[idx] = value[idx];
+bool Reader::convertString(const char* value, uint32_t length, Scratch& scratch,
+                           StringRef& result) {
+    if (!length) {
+        return false;
     }
-    double result = strtod((const char*)number_c_string, (char**)&after_end);
-    if (after_end != (number_c_string + length)) {
-        return 0.0f; /* parse_error */
+    if (!memchr(value, '\\', length)) {
+        result = StringRef(value, length);
+        return true;
     }
-    return result;
+    std::string text;
+    convertString(value, length, text);
+    result = StringRef(scratch.store(text.data(), text.size()), text.size());
+    return true;
 }
 
-const GenericNode* Reader::parse(const char* src) {
-    do {
-        ++alloc_;
-        StringStream is(src);
-        skipWhitespace(is);
-        if (is.Peek() != '\0') {
-            parseValue(is);
-        }
-    } while (false);
-
-    //
-    alloc_.reSize();
+const TapeNode* Reader::parse(const char* src) { return parse(src, strlen(src), false); }
+
+const TapeNode* Reader::parse(const char* src, size_t length, bool padded) {
+    document_ = this;
+    tape_.clear();
+    keys_.clear();
+    scratch_.clear();
+    str_error_.clear();
+    if (length > 0xFFFFFFFFU) {
+        // tape offsets are 32 bits
+        setError("DocumentTooLarge");
+        return NULL;
+    }
 
-    GenericNode* root = alloc_.allocValue();
-    cur_value_ = root;
+    cur_ = tape_.append(VALUE_NULL);
+    tape_.setLast(cur_);
 
-    StringStream is(src);
-    skipWhitespace(is);
-    if (is.Peek() != '\0') {
-        parseValue(is);
+    src_ = src;
+    length_ = length;
+    indexer_.reset(src_, length_, padded);
+    const size_t pos = indexer_.next();
+    if (pos != length_) {
+        parseValue(pos);
     }
     if (!str_error_.empty()) {
         return NULL;
     }
-    return root;
+    return tape_.root();
 }
 
 const char* Reader::getError() const {
@@ -122,252 +212,262 @@ const char* Reader::getError() const {
     return str_error_.c_str();
 }
 
-void Reader::parseValue(StringStream& is) {
-    switch (is.Peek()) {
+void Reader::attach(const Reader& document) {
+    document_ = &document;
+    keys_.clear();
+    scratch_.clear();
+    str_error_.clear();
+}
+
+void Reader::parseValue(const size_t pos) {
+    if (pos >= length_) {
+        setError("ValueInvalid");
+        return;
+    }
+    switch (src_[pos]) {
         case 'n':
-            parseNull(is);
+            parseNull(pos);
             break;
         case 't':
-            parseTrue(is);
+            parseTrue(pos);
             break;
         case 'f':
-            parseFalse(is);
+            parseFalse(pos);
             break;
         case '"':
-            parseString(is);
+            parseString(pos);
             break;
         case '{': {
-            GenericNode* parent = cur_value_;
+            const uint32_t parent = cur_;
             setItemType(VALUE_OBJECT);
-            parseObject(is);
-            cur_value_ = parent;
+            parseObject(pos);
+            cur_ = parent;
         } break;
         case '[': {
-            GenericNode* parent = cur_value_;
+            const uint32_t parent = cur_;
             setItemType(VALUE_ARRAY);
-            parseArray(is);
-            cur_value_ = parent;
+            parseArray(pos);
+            cur_ = parent;
         } break;
         default:
-            parseNumber(is);
+            parseNumber(pos);
             break;
     }
-    if (!str_error_.empty()) {
-        return;
-    }
 }
 
-void Reader::parseKey(StringStream& is) {
-    assert(is.Peek() == '\"');
-    is.Take();// Skip '\"'
-    const char* szStart = is.Strart();
-
-    for (; is.Peek() != '\0'; is.Take()) {
-        if (is.Peek() == '\"') {
-            setItemKey(szStart, (uint32_t)(is.Strart() - szStart));
-            is.Take();// Skip '\"'
-            return;
-        }
+void Reader::parseKey(const size_t pos) {
+    assert(src_[pos] == '\"');
+    // the indexer skips escaped quotes, the next structural closes the key
+    const size_t end = indexer_.next();
+    if (end >= length_ || src_[end] != '\"') {
+        setError("KeyInvalid");
+        return;
     }
-    setError("KeyInvalid");
+    setItemKey(src_ + pos + 1, (uint32_t)(end - pos - 1));
 }
 
-void Reader::parseNull(StringStream& is) {
-    assert(is.Peek() == 'n');
-    is.Take();
-
-    if (consume(is, 'u') && consume(is, 'l') && consume(is, 'l')) {
-        setItemValue(VALUE_NULL, "null", 4);
+void Reader::parseNull(const size_t pos) {
+    assert(src_[pos] == 'n');
+    if (consumeLiteral(pos, "null", 4)) {
+        setItemValue(VALUE_NULL, src_ + pos, 4);
     } else {
         setError("ValueInvalid");
     }
 }
 
-void Reader::parseTrue(StringStream& is) {
-    assert(is.Peek() == 't');
-    const char* szStart = is.Strart();
-    is.Take();
-
-    if (consume(is, 'r') && consume(is, 'u') && consume(is, 'e')) {
-        setItemValue(VALUE_BOOL, szStart, (uint32_t)(is.Strart() - szStart));
+void Reader::parseTrue(const size_t pos) {
+    assert(src_[pos] == 't');
+    if (consumeLiteral(pos, "true", 4)) {
+        setItemValue(VALUE_BOOL, src_ + pos, 4);
     } else {
         setError("ValueInvalid");
     }
 }
 
-void Reader::parseFalse(StringStream& is) {
-    assert(is.Peek() == 'f');
-    const char* szStart = is.Strart();
-    is.Take();
-
-    if (consume(is, 'a') && consume(is, 'l') && consume(is, 's') && consume(is, 'e')) {
-        setItemValue(VALUE_BOOL, szStart, (uint32_t)(is.Strart() - szStart));
+void Reader::parseFalse(const size_t pos) {
+    assert(src_[pos] == 'f');
+    if (consumeLiteral(pos, "false", 5)) {
+        setItemValue(VALUE_BOOL, src_ + pos, 5);
     } else {
         setError("ValueInvalid");
     }
 }
 
-void Reader::parseString(StringStream& is) {
-    assert(is.Peek() == '\"');
-    is.Take();// Skip '\"'
-    const char* szStart = is.Strart();
+void Reader::parseString(const size_t pos) {
+    assert(src_[pos] == '\"');
+    const size_t end = indexer_.next();
+    if (end >= length_ || src_[end] != '\"') {
+        setError("ValueInvalid");
+        return;
+    }
+    setItemValue(VALUE_STRING, src_ + pos + 1, (uint32_t)(end - pos - 1));
+}
 
-    for (; is.Peek() != '\0'; is.Take()) {
-        if (is.Peek() == '\"' && is.Second2Last() != '\\') {
-            setItemValue(VALUE_STRING, szStart, (uint32_t)(is.Strart() - szStart));
-            is.Take();// Skip '\"'
+void Reader::parseNumber(const size_t pos) {
+    // -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][-+]?[0-9]+)?
+    size_t end = pos;
+    if (end < length_ && src_[end] == '-') {
+        ++end;
+    }
+    if (end < length_ && src_[end] == '0') {
+        ++end;
+    } else {
+        const size_t digits = end;
+        end = skipDigits(end);
+        if (end == digits) {
+            setError("ValueInvalid");
             return;
         }
     }
-    setError("ValueInvalid");
-}
-
-void Reader::parseNumber(StringStream& is) {
-    const char* szStart = is.Strart();
-
-    for (; is.Peek() != '\0'; is.Take()) {
-        if (is.Peek() == '-' || is.Peek() == '.' || (is.Peek() >= '0' && is.Peek() <= '9')) {
-            continue;
-        } else {
-            setItemValue(VALUE_NUMBER, szStart, (uint32_t)(is.Strart() - szStart));
+    if (end < length_ && src_[end] == '.') {
+        const size_t fraction = ++end;
+        end = skipDigits(end);
+        if (end == fraction) {
+            setError("ValueInvalid");
+            return;
+        }
+    }
+    if (end < length_ && (src_[end] == 'e' || src_[end] == 'E')) {
+        ++end;
+        if (end < length_ && (src_[end] == '-' || src_[end] == '+')) {
+            ++end;
+        }
+        const size_t exponent = end;
+        end = skipDigits(end);
+        if (end == exponent) {
+            setError("ValueInvalid");
             return;
         }
     }
-    setError("ValueInvalid");
+    if (!isDelimiter(end)) {
+        setError("ValueInvalid");
+        return;
+    }
+    setItemValue(VALUE_NUMBER, src_ + pos, (uint32_t)(end - pos));
 }
 
-void Reader::parseArray(StringStream& is) {
-    assert(is.Peek() == '[');
-    is.Take();// Skip '['
+void Reader::parseArray(const size_t pos) {
+    assert(src_[pos] == '[');
+    (void)pos;
+    const uint32_t array = cur_;
 
-    skipWhitespace(is);
-    if (consume(is, ']')) {
+    size_t token = indexer_.next();
+    if (token < length_ && src_[token] == ']') {
+        tape_.closeContainer(array, 0, 0);
         return;
     }
 
     for (uint32_t elementIndex = 0;;) {
-        getChildItem(elementIndex);
-        parseValue(is);
+        const uint32_t element = tape_.append(VALUE_NULL);
+        cur_ = element;
+        parseValue(token);
+        if (!str_error_.empty()) {
+            return;
+        }
         ++elementIndex;
-        skipWhitespace(is);
 
-        if (consume(is, ',')) {
-            skipWhitespace(is);
-        } else if (consume(is, ']')) {
+        token = indexer_.next();
+        if (token < length_ && src_[token] == ',') {
+            token = indexer_.next();
+        } else if (token < length_ && src_[token] == ']') {
+            tape_.closeContainer(array, elementIndex, element);
             return;
         } else {
             setError("ParseErrorArrayMissCommaOrSquareBracket");
             return;
         }
     }
-    setError("ValueArrayInvalid");
 }
 
-void Reader::parseObject(StringStream& is) {
-    assert(is.Peek() == '{');
-    //        const char* szStart = is.Strart();
-    is.Take();// Skip '{'
+void Reader::parseObject(const size_t pos) {
+    assert(src_[pos] == '{');
+    (void)pos;
+    const uint32_t object = cur_;
 
-    skipWhitespace(is);
-    if (is.Peek() == '}') {
-        is.Take();
+    size_t token = indexer_.next();
+    if (token < length_ && src_[token] == '}') {
+        tape_.closeContainer(object, 0, 0);
         return;
     }
 
-    for (uint32_t elementIndex = 0; !is.isEnd();) {
-        if (is.Peek() != '"') {
+    for (uint32_t elementIndex = 0;;) {
+        if (token >= length_ || src_[token] != '"') {
             setError("ObjectMissName");
             return;
         }
-        getChildItem(elementIndex);
-        parseKey(is);
+        const uint32_t member = tape_.append(VALUE_NULL);
+        cur_ = member;
+        parseKey(token);
+        if (!str_error_.empty()) {
+            return;
+        }
 
-        skipWhitespace(is);
-        if (!consume(is, ':')) {
+        token = indexer_.next();
+        if (token >= length_ || src_[token] != ':') {
             setError("ObjectMissColon");
             return;
         }
 
-        skipWhitespace(is);
-        parseValue(is);
+        parseValue(indexer_.next());
+        if (!str_error_.empty()) {
+            return;
+        }
         ++elementIndex;
 
-        skipWhitespace(is);
-        switch (is.Peek()) {
-            case ',':
-                is.Take();
-                skipWhitespace(is);
-                break;
-            case '}':
-                is.Take();
-                return;
-            default:
-                setError("ObjectMissCommaOrCurlyBracket");
-                break;// This useless break is only for making warning and
-                      // coverage happy
+        token = indexer_.next();
+        if (token < length_ && src_[token] == ',') {
+            token = indexer_.next();
+        } else if (token < length_ && src_[token] == '}') {
+            tape_.closeContainer(object, elementIndex, member);
+            return;
+        } else {
+            setError("ObjectMissCommaOrCurlyBracket");
+            return;
         }
     }
 }
 
 void Reader::setItemType(const int32_t type) {
-    if (cur_value_) {
-        assert(VALUE_NULL <= type && type <= VALUE_OBJECT);
-        cur_value_->type = type;
-    }
-}
-
-void Reader::getChildItem(const uint32_t element_index) {
-    if (cur_value_) {
-        GenericNode* temp = cur_value_;
-        cur_value_ = alloc_.allocValue();
-        cur_value_->prev = temp;
-        if (!element_index) {
-            temp->child = cur_value_;
-        } else {
-            temp->next = cur_value_;
-        }
-    } else {
-        ++alloc_;
-    }
+    assert(VALUE_NULL <= type && type <= VALUE_OBJECT);
+    tape_.setType(cur_, type);
 }
 
 void Reader::setItemKey(const char* key, const uint32_t key_size) {
-    if (cur_value_) {
-        assert(key);
-        assert(key_size);
-        cur_value_->key = key;
-        cur_value_->key_size = key_size;
+    assert(key);
+    if (key_size > TapeNode::KEY_SIZE_MAX) {
+        setError("KeyInvalid");
+        return;
     }
+    tape_.setKey(cur_, (uint32_t)(key - src_), key_size);
 }
 
 void Reader::setItemValue(const int32_t type, const char* value, const uint32_t value_size) {
-    if (cur_value_) {
-        assert(VALUE_NULL <= type && type <= VALUE_OBJECT);
-        assert(value);
-        assert(type == VALUE_STRING || value_size);
-        cur_value_->type = type;
-        cur_value_->value = value;
-        cur_value_->value_size = value_size;
-    }
+    assert(VALUE_NULL <= type && type <= VALUE_OBJECT);
+    assert(value);
+    assert(type == VALUE_STRING || value_size);
+    tape_.setType(cur_, type);
+    tape_.setValue(cur_, (uint32_t)(value - src_), value_size);
 }
 
-bool Reader::consume(StringStream& is, const char expect) {
-    if (is.Peek() == expect) {
-        is.Take();
-        return true;
-    } else
+bool Reader::consumeLiteral(const size_t pos, const char* literal, const uint32_t literal_size) {
+    if (length_ - pos < literal_size || memcmp(src_ + pos, literal, literal_size) != 0) {
         return false;
+    }
+    return isDelimiter(pos + literal_size);
 }
 
-void Reader::skipWhitespace(StringStream& is) {
-    for (;;) {
-        const char c = is.Peek();
-        if (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
-            is.Take();
-        } else {
-            break;
-        }
+size_t Reader::skipDigits(size_t pos) const {
+    while (pos < length_ && '0' <= src_[pos] && src_[pos] <= '9') {
+        ++pos;
+    }
+    return pos;
+}
+
+bool Reader::isDelimiter(const size_t pos) const {
+    if (pos >= length_) {
+        return true;
     }
+    return StructuralIndexer::isWhitespace(src_[pos]) || StructuralIndexer::isOperator(src_[pos]);
 }
 
 }// namespace json
@@ -4,8 +4,14 @@
 #include <cstdlib>
 #include <ctype.h>
 #include <stdio.h>
+#include <string.h>
 #include <string>
-#include "node.h"
+#include <serialflex/string_ref.h>
+#include "indexer.h"
+#include "key_index.h"
+#include "scratch.h"
+#include "shape_cache.h"
+#include "tape.h"
 
 namespace serialflex {
 
@@ -20,42 +26,74 @@ enum {
     VALUE_OBJECT = 5
 };
 
-class StringStream;
 class Reader {
-    GenericNode* cur_value_;
-    std::vector<GenericNode> values_;
-    GenericNodeAllocator<GenericNode> alloc_;
+    Tape tape_;
+    KeyIndex keys_;
+    ShapeCache shapes_;// kept across parses
+    Scratch scratch_;
+    uint32_t cur_;// tape index of the node being parsed
+    StructuralIndexer indexer_;
+    const char* src_;
+    size_t length_;
     std::string str_error_;
+    const Reader* document_;// this, or the reader whose tape and source a worker reads
 
 public:
     Reader();
     ~Reader();
-    const GenericNode* parse(const char* src);
+    const TapeNode* parse(const char* src);
+    // padded: at least INPUT_PADDING readable bytes follow src + length
+    const TapeNode* parse(const char* src, size_t length, bool padded);
     const char* getError() const;
+    // A worker reads the document parsed by another reader, from a thread of its own, while
+    // that one is not parsed again. Its key tables and scratch are its own and start empty.
+    void attach(const Reader& document);
+    // tape offsets are relative to the source of the last parse
+    const char* getSource() const { return document_->src_; }
+    // child of a wide object keyed name, through a table built on the first lookup
+    const TapeNode* findKey(const TapeNode* object, const char* name, uint32_t name_size,
+                            bool case_insensitive) {
+        return keys_.find(document_->tape_, document_->src_, object, name, name_size,
+                          case_insensitive);
+    }
+    // field order of the message types decoded so far
+    ShapeCache& getShapes() { return shapes_; }
+    // unescaped text of StringRef fields, valid until the next parse
+    Scratch& getScratch() { return scratch_; }
+    void setError(const char* error) { str_error_ = error; }
 
-    static int64_t convertInt(const char* value, uint32_t length);
-    static uint64_t convertUint(const char* value, uint32_t length);
-    static double convertDouble(const char* value, uint32_t length);
+    // false on bad syntax or when the value does not fit
+    static bool convertInt(const char* value, uint32_t length, int32_t& result);
+    static bool convertInt(const char* value, uint32_t length, int64_t& result);
+    static bool convertUint(const char* value, uint32_t length, uint32_t& result);
+    static bool convertUint(const char* value, uint32_t length, uint64_t& result);
+    static bool convertDouble(const char* value, uint32_t length, double& result);
+    static bool convertFloat(const char* value, uint32_t length, float& result);
+    // unescapes a string value and appends it to result
+    static bool convertString(const char* value, uint32_t length, std::string& result);
+    // points result into value unless it has escapes, which are unescaped into scratch
+    static bool convertString(const char* value, uint32_t length, Scratch& scratch,
+                              StringRef& result);
 
 private:
-    void setError(const char* error) { str_error_ = error; }
-    void parseValue(StringStream& is);
-    void parseKey(StringStream& is);
-    void parseNull(StringStream& is);
-    void parseTrue(StringStream& is);
-    void parseFalse(StringStream& is);
-    void parseString(StringStream& is);
-    void parseNumber(StringStream& is);
-    void parseArray(StringStream& is);
-    void parseObject(StringStream& is);
+    // pos is the offset of the value's structural character
+    void parseValue(const size_t pos);
+    void parseKey(const size_t pos);
+    void parseNull(const size_t pos);
+    void parseTrue(const size_t pos);
+    void parseFalse(const size_t pos);
+    void parseString(const size_t pos);
+    void parseNumber(const size_t pos);
+    void parseArray(const size_t pos);
+    void parseObject(const size_t pos);
 
     void setItemType(const int32_t type);
-    void getChildItem(const uint32_t element_index);
     void setItemKey(const char* key, const uint32_t key_size);
     void setItemValue(const int32_t type, const char* value, const uint32_t value_size);
 
-    static bool consume(StringStream& is, const char expect);
-    static void skipWhitespace(StringStream& is);
+    bool consumeLiteral(const size_t pos, const char* literal, const uint32_t literal_size);
+    size_t skipDigits(size_t pos) const;
+    bool isDelimiter(const size_t pos) const;
 };
 
 }// namespace json
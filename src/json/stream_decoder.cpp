@@ -0,0 +1,37 @@
+#include <json/stream_reader.h>
+#include <serialflex/json/stream_decoder.h>
+
+namespace serialflex {
+
+JSONStreamDecoder::JSONStreamDecoder(bool case_insensitive): reader_(NULL) {
+    reader_ = new json::StreamReader();
+    decoder_.setCaseInsensitive(case_insensitive);
+}
+
+JSONStreamDecoder::~JSONStreamDecoder() { delete reader_; }
+
+void JSONStreamDecoder::reset() { reader_->reset(); }
+
+JSONStreamDecoder& JSONStreamDecoder::setConvertByType(bool convert_by_type) {
+    decoder_.setConvertByType(convert_by_type);
+    return *this;
+}
+
+const char* JSONStreamDecoder::getError() const { return reader_->getError(); }
+
+void JSONStreamDecoder::beginChunk(const char* chunk, size_t len) { reader_->feed(chunk, len); }
+
+bool JSONStreamDecoder::nextElement(const char*& element, size_t& size) {
+    return reader_->next(element, size);
+}
+
+bool JSONStreamDecoder::finishElement(const char*& element, size_t& size) {
+    return reader_->finish(element, size);
+}
+
+void JSONStreamDecoder::setDecodeError() {
+    const char* error = decoder_.getError();
+    reader_->setError(error ? error : "ElementInvalid");
+}
+
+}// namespace serialflex
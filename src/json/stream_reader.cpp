@@ -0,0 +1,228 @@
+#include "stream_reader.h"
+
+namespace serialflex {
+
+namespace json {
+
+StreamReader::StreamReader()
+    : state_(STATE_START), array_mode_(false), expect_value_(false), depth_(0),
+      in_string_(false), escape_(false), scalar_(false), chunk_(NULL), chunk_end_(NULL),
+      cursor_(NULL), element_start_(NULL), buffer_ready_(false) {}
+
+void StreamReader::reset() {
+    state_ = STATE_START;
+    array_mode_ = false;
+    expect_value_ = false;
+    depth_ = 0;
+    in_string_ = false;
+    escape_ = false;
+    scalar_ = false;
+    chunk_ = NULL;
+    chunk_end_ = NULL;
+    cursor_ = NULL;
+    element_start_ = NULL;
+    buffer_.clear();
+    buffer_ready_ = false;
+    str_error_.clear();
+}
+
+void StreamReader::feed(const char* chunk, size_t len) {
+    if (buffer_ready_) {
+        buffer_.clear();
+        buffer_ready_ = false;
+    }
+    chunk_ = chunk;
+    chunk_end_ = chunk + len;
+    cursor_ = chunk;
+    // an element left open by the previous chunk continues here
+    element_start_ = (state_ == STATE_ELEMENT) ? chunk : NULL;
+}
+
+bool StreamReader::next(const char*& element, size_t& size) {
+    if (buffer_ready_) {
+        buffer_.clear();
+        buffer_ready_ = false;
+    }
+    while (str_error_.empty() && cursor_ < chunk_end_) {
+        const char c = *cursor_;
+        if (state_ != STATE_ELEMENT && isWhitespace(c)) {
+            ++cursor_;
+            continue;
+        }
+        switch (state_) {
+            case STATE_START:
+                if (c == '[') {
+                    array_mode_ = true;
+                    state_ = STATE_ARRAY_VALUE;
+                    ++cursor_;
+                } else {
+                    beginElement(cursor_);
+                }
+                break;
+            case STATE_SEQUENCE_NEXT:
+                beginElement(cursor_);
+                break;
+            case STATE_ARRAY_VALUE:
+                if (c == ']' && !expect_value_) {
+                    state_ = STATE_DONE;
+                    ++cursor_;
+                } else if (c == ']' || c == ',') {
+                    setError("ParseErrorArrayMissValue");
+                } else {
+                    beginElement(cursor_);
+                }
+                break;
+            case STATE_ARRAY_NEXT:
+                if (c == ',') {
+                    expect_value_ = true;
+                    state_ = STATE_ARRAY_VALUE;
+                    ++cursor_;
+                } else if (c == ']') {
+                    state_ = STATE_DONE;
+                    ++cursor_;
+                } else {
+                    setError("ParseErrorArrayMissCommaOrSquareBracket");
+                }
+                break;
+            case STATE_ELEMENT:
+                if (scanElement()) {
+                    endElement(cursor_, element, size);
+                    return true;
+                }
+                break;
+            default:
+                setError("TrailingCharacters");
+                break;
+        }
+    }
+    if (str_error_.empty() && state_ == STATE_ELEMENT && element_start_) {
+        // keep the unfinished element, the chunk goes away
+        buffer_.append(element_start_, chunk_end_ - element_start_);
+        element_start_ = NULL;
+    }
+    return false;
+}
+
+bool StreamReader::finish(const char*& element, size_t& size) {
+    if (buffer_ready_) {
+        buffer_.clear();
+        buffer_ready_ = false;
+    }
+    if (!str_error_.empty()) {
+        return false;
+    }
+    if (state_ == STATE_ELEMENT && scalar_ && !array_mode_) {
+        // a number or literal is only terminated by the end of a value sequence
+        element = buffer_.data();
+        size = buffer_.size();
+        buffer_ready_ = true;
+        state_ = STATE_SEQUENCE_NEXT;
+        return true;
+    }
+    if (state_ == STATE_ELEMENT || state_ == STATE_ARRAY_VALUE || state_ == STATE_ARRAY_NEXT) {
+        setError("UnexpectedEndOfStream");
+    }
+    return false;
+}
+
+const char* StreamReader::getError() const {
+    if (str_error_.empty()) {
+        return NULL;
+    }
+    return str_error_.c_str();
+}
+
+bool StreamReader::scanElement() {
+    while (cursor_ < chunk_end_) {
+        if (in_string_) {
+            if (escape_) {
+                escape_ = false;
+                ++cursor_;
+                continue;
+            }
+            const char* pos = cursor_;
+            for (; pos < chunk_end_ && *pos != '"' && *pos != '\\'; ++pos) {
+            }
+            cursor_ = pos;
+            if (pos == chunk_end_) {
+                return false;
+            }
+            ++cursor_;
+            if (*pos == '\\') {
+                escape_ = true;
+            } else {
+                in_string_ = false;
+                if (!depth_) {
+                    return true;
+                }
+            }
+            continue;
+        }
+
+        const char c = *cursor_;
+        if (scalar_) {
+            if (isWhitespace(c) || c == ',' || c == ']' || c == '}' || c == '[' || c == '{' ||
+                c == '"' || c == ':') {
+                return true;
+            }
+            ++cursor_;
+            continue;
+        }
+        switch (c) {
+            case '"':
+                in_string_ = true;
+                break;
+            case '{':
+            case '[':
+                ++depth_;
+                break;
+            case '}':
+            case ']':
+                if (!depth_) {
+                    setError("ValueInvalid");
+                    return false;
+                }
+                if (!--depth_) {
+                    ++cursor_;
+                    return true;
+                }
+                break;
+            default:
+                if (!depth_) {
+                    scalar_ = true;
+                }
+                break;
+        }
+        ++cursor_;
+    }
+    return false;
+}
+
+void StreamReader::beginElement(const char* start) {
+    state_ = STATE_ELEMENT;
+    expect_value_ = false;
+    depth_ = 0;
+    in_string_ = false;
+    escape_ = false;
+    scalar_ = false;
+    element_start_ = start;
+}
+
+void StreamReader::endElement(const char* end, const char*& element, size_t& size) {
+    if (buffer_.empty()) {
+        // the whole element is inside the current chunk
+        element = element_start_;
+        size = end - element_start_;
+    } else {
+        buffer_.append(element_start_, end - element_start_);
+        element = buffer_.data();
+        size = buffer_.size();
+        buffer_ready_ = true;
+    }
+    element_start_ = NULL;
+    state_ = array_mode_ ? STATE_ARRAY_NEXT : STATE_SEQUENCE_NEXT;
+}
+
+}// namespace json
+
+}// namespace serialflex
@@ -0,0 +1,78 @@
+#ifndef __JSON_STREAM_READER_H__
+#define __JSON_STREAM_READER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace serialflex {
+
+namespace json {
+
+// Push-style splitter for a document that arrives in chunks. It tracks just enough state
+// (nesting depth, strings and escapes) to find where each element of the top-level array
+// ends; the elements themselves are parsed by json::Reader. A stream that does not start
+// with '[' is read as a sequence of whitespace-separated values (JSON lines).
+class StreamReader {
+    enum {
+        STATE_START = 0,    // before the first value of the stream
+        STATE_ARRAY_VALUE,  // inside the top-level array, expecting an element or ']'
+        STATE_ARRAY_NEXT,   // after an element, expecting ',' or ']'
+        STATE_SEQUENCE_NEXT,// after a top-level value in sequence mode
+        STATE_ELEMENT,      // inside an element
+        STATE_DONE          // top-level array closed
+    };
+
+    int32_t state_;
+    bool array_mode_;
+    bool expect_value_;// after ',', ']' is not allowed
+    uint32_t depth_;
+    bool in_string_;
+    bool escape_;
+    bool scalar_;// element is a number or literal, ends at the next delimiter
+
+    const char* chunk_;
+    const char* chunk_end_;
+    const char* cursor_;
+    const char* element_start_;// start of the element in the current chunk
+    std::string buffer_;      // element bytes carried over from earlier chunks
+    bool buffer_ready_;       // buffer_ holds a complete element that was handed out
+
+    std::string str_error_;
+
+    StreamReader(const StreamReader&);
+    StreamReader& operator=(const StreamReader&);
+
+public:
+    StreamReader();
+    ~StreamReader() {}
+
+    void reset();
+    // start scanning a chunk, the chunk must stay valid until next() returns false
+    void feed(const char* chunk, size_t len);
+    // next element completed in the current chunk, false when the chunk is used up
+    bool next(const char*& element, size_t& size);
+    // end of stream, may hand out a trailing scalar of a value sequence
+    bool finish(const char*& element, size_t& size);
+
+    const char* getError() const;
+    void setError(const char* error) {
+        str_error_ = error;
+        state_ = STATE_DONE;
+    }
+
+private:
+    bool scanElement();
+    void beginElement(const char* start);
+    void endElement(const char* end, const char*& element, size_t& size);
+
+    static bool isWhitespace(const char c) {
+        return (c == ' ' || c == '\n' || c == '\r' || c == '\t');
+    }
+};
+
+}// namespace json
+
+}// namespace serialflex
+
+#endif
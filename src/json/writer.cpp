@@ -1,20 +1,92 @@
 #include <assert.h>
-#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <number/writer.h>
 #include "writer.h"
+#include "../simd.h"
 
 namespace serialflex {
 
 namespace json {
 
+// escape of each control character, "\u00XX" where JSON has no short one
+static const char kControlEscapes[32][7] = {
+    "\\u0000", "\\u0001", "\\u0002", "\\u0003", "\\u0004", "\\u0005", "\\u0006", "\\u0007",
+    "\\b",     "\\t",     "\\n",     "\\u000b", "\\f",     "\\r",     "\\u000e", "\\u000f",
+    "\\u0010", "\\u0011", "\\u0012", "\\u0013", "\\u0014", "\\u0015", "\\u0016", "\\u0017",
+    "\\u0018", "\\u0019", "\\u001a", "\\u001b", "\\u001c", "\\u001d", "\\u001e", "\\u001f"};
+
+static inline bool isUnsafe(unsigned char c) { return c < 0x20 || c == '"' || c == '\\'; }
+
+// position of the first character in [pos, length) that needs an escape, length if none does
+static size_t findUnsafe(const char* str, size_t pos, size_t length) {
+#ifdef SERIALFLEX_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+    for (; length - pos >= 16; pos += 16) {
+        const __m128i block = _mm_loadu_si128((const __m128i*)(str + pos));
+        // bytes up to 0x1F are left unchanged by the unsigned max with 0x1F
+        const __m128i unsafe =
+            _mm_or_si128(_mm_cmpeq_epi8(_mm_max_epu8(block, control), control),
+                         _mm_or_si128(_mm_cmpeq_epi8(block, quote),
+                                      _mm_cmpeq_epi8(block, backslash)));
+        const uint32_t mask = (uint32_t)_mm_movemask_epi8(unsafe);
+        if (mask) {
+            return pos + simd::trailingZeros(mask);
+        }
+    }
+#endif
+    while (pos < length && !isUnsafe((unsigned char)str[pos])) {
+        ++pos;
+    }
+    return pos;
+}
+
+Writer::Writer(std::string& str, bool formatted)
+    : string_sink_(new StringSink(str)), sink_(*string_sink_), formatted_(formatted) {}
+
+Writer::Writer(OutputSink& sink, bool formatted)
+    : string_sink_(NULL), sink_(sink), formatted_(formatted) {}
+
+Writer::~Writer() { delete string_sink_; }
+
+template <typename T>
+void Writer::appendNumber(T value) {
+    if (sink_.room() >= number::MAX_NUMBER_SIZE) {
+        sink_.advance(number::formatNumber(value, sink_.cursor()));
+    } else {
+        // the end of a fixed buffer may still hold this one
+        char buffer[number::MAX_NUMBER_SIZE];
+        sink_.write(buffer, number::formatNumber(value, buffer));
+    }
+}
+
 Writer& Writer::key(const char* key) {
     if (key) {
         value_type& vt = stack_.back();
         if (vt.second) {
-            comma(str_);
+            comma();
+        }
+        tab((int32_t)stack_.size());
+        uint32_t size = 0;
+        const char* token = keys_.find(key, 0, size);
+        if (token) {
+            sink_.write(token, size);
+        } else if (!keys_.repeated(key)) {
+            appendString(sink_, key, strlen(key));
+            sink_.write(formatted_ ? ": " : ":");
+        } else {
+            // rendered once with the colon, later keys of this name are a single copy
+            const size_t length = strlen(key);
+            token_.clear();
+            StringSink sink(token_);
+            appendString(sink, key, length);
+            sink.write(formatted_ ? ": " : ":");
+            sink.flush();
+            keys_.insert(key, (uint32_t)length, &token_, 1);
+            sink_.write(token_.data(), token_.size());
         }
-        tab(str_, (int32_t)stack_.size());
-        appendString(str_, key);
         vt.second++;
         vt.first = KEY_TYPE;
     }
@@ -23,213 +95,180 @@ Writer& Writer::key(const char* key) {
 
 void Writer::value(bool b) {
     value_type& vt = stack_.back();
-    if (vt.first == KEY_TYPE) {
-        colon(str_);
-    } else if (vt.first == VALUE_TYPE) {
-        comma(str_);
-        tab(str_, (int32_t)stack_.size());
-    } else {
-        tab(str_, (int32_t)stack_.size());
+    if (vt.first == VALUE_TYPE) {
+        comma();
+        tab((int32_t)stack_.size());
+    } else if (vt.first == NULL_TYPE) {
+        tab((int32_t)stack_.size());
     }
     if (b) {
-        str_.append("true");
+        sink_.write("true", 4);
     } else {
-        str_.append("false");
+        sink_.write("false", 5);
     }
     vt.first = VALUE_TYPE;
 }
 
 void Writer::value(int64_t i64) {
     value_type& vt = stack_.back();
-    if (vt.first == KEY_TYPE) {
-        colon(str_);
-    } else if (vt.first == VALUE_TYPE) {
-        comma(str_);
-        tab(str_, (int32_t)stack_.size());
-    } else {
-        tab(str_, (int32_t)stack_.size());
+    if (vt.first == VALUE_TYPE) {
+        comma();
+        tab((int32_t)stack_.size());
+    } else if (vt.first == NULL_TYPE) {
+        tab((int32_t)stack_.size());
     }
-    char buffer[32] = {0};
-    snprintf(buffer, 32, "%lld", i64);
-    str_.append(buffer);
+    appendNumber(i64);
     vt.first = VALUE_TYPE;
 }
 
 void Writer::value(uint64_t u64) {
     value_type& vt = stack_.back();
-    if (vt.first == KEY_TYPE) {
-        colon(str_);
-    } else if (vt.first == VALUE_TYPE) {
-        comma(str_);
-        tab(str_, (int32_t)stack_.size());
-    } else {
-        tab(str_, (int32_t)stack_.size());
+    if (vt.first == VALUE_TYPE) {
+        comma();
+        tab((int32_t)stack_.size());
+    } else if (vt.first == NULL_TYPE) {
+        tab((int32_t)stack_.size());
     }
-    char buffer[32] = {0};
-    snprintf(buffer, 32, "%llu", u64);
-    str_.append(buffer);
+    appendNumber(u64);
     vt.first = VALUE_TYPE;
 }
 
 void Writer::value(double d) {
     value_type& vt = stack_.back();
-    if (vt.first == KEY_TYPE) {
-        colon(str_);
-    } else if (vt.first == VALUE_TYPE) {
-        comma(str_);
-        tab(str_, (int32_t)stack_.size());
-    } else {
-        tab(str_, (int32_t)stack_.size());
+    if (vt.first == VALUE_TYPE) {
+        comma();
+        tab((int32_t)stack_.size());
+    } else if (vt.first == NULL_TYPE) {
+        tab((int32_t)stack_.size());
     }
-    char buffer[64] = {0};
-    snprintf(buffer, 64, "%lf", d);
-    str_.append(buffer);
+    appendNumber(d);
     vt.first = VALUE_TYPE;
 }
 
-void Writer::value(const char* value) {
+void Writer::value(float f) {
     value_type& vt = stack_.back();
-    if (vt.first == KEY_TYPE) {
-        colon(str_);
-    } else if (vt.first == VALUE_TYPE) {
-        comma(str_);
-        tab(str_, (int32_t)stack_.size());
-    } else {
-        tab(str_, (int32_t)stack_.size());
+    if (vt.first == VALUE_TYPE) {
+        comma();
+        tab((int32_t)stack_.size());
+    } else if (vt.first == NULL_TYPE) {
+        tab((int32_t)stack_.size());
+    }
+    appendNumber(f);
+    vt.first = VALUE_TYPE;
+}
+
+void Writer::value(const char* value, size_t size) {
+    value_type& vt = stack_.back();
+    if (vt.first == VALUE_TYPE) {
+        comma();
+        tab((int32_t)stack_.size());
+    } else if (vt.first == NULL_TYPE) {
+        tab((int32_t)stack_.size());
     }
-    appendString(str_, value);
+    appendString(sink_, value, size);
     vt.first = VALUE_TYPE;
 }
 
 void Writer::startObject() {
     if (!stack_.empty()) {
-        if (stack_.back().first == KEY_TYPE) {
-            colon(str_);
-        } else if (stack_.back().first == VALUE_TYPE) {
-            comma(str_);
-        } else {
-            tab(str_, (int32_t)stack_.size());
+        if (stack_.back().first == VALUE_TYPE) {
+            comma();
+        } else if (stack_.back().first == NULL_TYPE) {
+            tab((int32_t)stack_.size());
         }
     }
     stack_.push_back(value_type(NULL_TYPE, 0));
-    leftBrace(str_);
+    leftBrace();
 }
 
 void Writer::endObject() {
-    rightBrace(str_, (int32_t)stack_.size());
+    rightBrace((int32_t)stack_.size());
     stack_.pop_back();
 }
 
 void Writer::startArray() {
     if (!stack_.empty()) {
-        if (stack_.back().first == KEY_TYPE) {
-            colon(str_);
-        } else if (stack_.back().first == VALUE_TYPE) {
-            comma(str_);
-        } else {
-            tab(str_, (int32_t)stack_.size());
+        if (stack_.back().first == VALUE_TYPE) {
+            comma();
+        } else if (stack_.back().first == NULL_TYPE) {
+            tab((int32_t)stack_.size());
         }
     }
-    leftBracket(str_);
+    leftBracket();
     stack_.push_back(value_type(NULL_TYPE, 0));
 }
 
 void Writer::endArray() {
-    rightBracket(str_, (int32_t)stack_.size());
+    rightBracket((int32_t)stack_.size());
     stack_.pop_back();
 }
 
-void Writer::colon(std::string& str) const {
-    str.append(1, ':');
-    if (formatted_) {
-        str.append(1, ' ');
-    }
-}
-
-void Writer::comma(std::string& str) const {
-    str.append(1, ',');
+void Writer::comma() const {
+    sink_.put(',');
     if (formatted_) {
-        str.append(1, '\n');
+        sink_.put('\n');
     }
 }
 
-void Writer::leftBrace(std::string& str) const {
-    str.append(1, '{');
+void Writer::leftBrace() const {
+    sink_.put('{');
     if (formatted_) {
-        str.append(1, '\n');
+        sink_.put('\n');
     }
 }
 
-void Writer::rightBrace(std::string& str, int32_t layer) const {
+void Writer::rightBrace(int32_t layer) const {
     if (formatted_) {
-        str.append(1, '\n');
-        tab(str, layer - 1);
+        sink_.put('\n');
+        tab(layer - 1);
     }
-    str.append(1, '}');
+    sink_.put('}');
 }
 
-void Writer::leftBracket(std::string& str) const {
-    str.append(1, '[');
+void Writer::leftBracket() const {
+    sink_.put('[');
     if (formatted_) {
-        str.append(1, '\n');
+        sink_.put('\n');
     }
 }
 
-void Writer::rightBracket(std::string& str, int32_t layer) const {
+void Writer::rightBracket(int32_t layer) const {
     if (formatted_) {
-        str.append(1, '\n');
-        tab(str, layer - 1);
+        sink_.put('\n');
+        tab(layer - 1);
     }
-    str.append(1, ']');
+    sink_.put(']');
 }
 
-void Writer::tab(std::string& str, int32_t layer) const {
+void Writer::tab(int32_t layer) const {
     if (formatted_) {
         for (int32_t idx = 0; idx < layer; ++idx) {
-            str.append(1, '\t');
+            sink_.put('\t');
         }
     }
 }
 
-void Writer::appendString(std::string& str, const char* value) {
-    str.append(1, '\"');
-    for (const char* ptr = value; *ptr; ++ptr) {
-        if ((unsigned char)*ptr > 31 && *ptr != '\"' && *ptr != '\\') {
-            str.append(1, *ptr);
+void Writer::appendString(OutputSink& sink, const char* value, size_t size) {
+    sink.put('\"');
+    size_t pos = 0;
+    for (;;) {
+        // the characters up to the next escape go out in one piece
+        const size_t escape = findUnsafe(value, pos, size);
+        sink.write(value + pos, escape - pos);
+        if (escape == size) {
+            break;
+        }
+        const unsigned char c = (unsigned char)value[escape];
+        if (c == '\"') {
+            sink.write("\\\"", 2);
+        } else if (c == '\\') {
+            sink.write("\\\\", 2);
         } else {
-            str.append(1, '\\');
-            switch (*ptr) {
-                case '\\':
-                    str.append(1, '\\');
-                    break;
-                case '\"':
-                    str.append(1, '\"');
-                    break;
-                case '\b':
-                    str.append(1, 'b');
-                    break;
-                case '\f':
-                    str.append(1, 'f');
-                    break;
-                case '\n':
-                    str.append(1, 'n');
-                    break;
-                case '\r':
-                    str.append(1, 'r');
-                    break;
-                case '\t':
-                    str.append(1, 't');
-                    break;
-                default: {
-                    size_t nSize = str.size();
-                    str.resize(nSize + 5, '\0');
-                    sprintf(&str.at(nSize), "u%04x", *ptr);
-                    break;
-                }
-            }
+            sink.write(kControlEscapes[c], kControlEscapes[c][1] == 'u' ? 6 : 2);
         }
+        pos = escape + 1;
     }
-    str.append(1, '\"');
+    sink.put('\"');
 }
 
 }// namespace json
@@ -2,6 +2,8 @@
 #define __JSON_WRITER_H__
 
 #include <stdint.h>
+#include <serialflex/sink.h>
+#include <key_tokens.h>
 #include <string>
 #include <utility>
 #include <vector>
@@ -18,18 +20,27 @@ class Writer {
     };
     typedef std::pair<int32_t, uint32_t> value_type;
     std::vector<value_type> stack_;
-    std::string& str_;
+    StringSink* string_sink_;// owned when writing into a string
+    OutputSink& sink_;
     bool formatted_;
+    KeyTokens keys_;   // "key": per field name
+    std::string token_;// a key being rendered
+
+    Writer(const Writer&);
+    Writer& operator=(const Writer&);
 
 public:
-    explicit Writer(std::string& str, bool formatted = false): str_(str), formatted_(formatted) {}
+    explicit Writer(std::string& str, bool formatted = false);
+    explicit Writer(OutputSink& sink, bool formatted = false);
+    ~Writer();
     // key and value
     Writer& key(const char* key);
     void value(bool b);
     void value(int64_t i64);
     void value(uint64_t u64);
     void value(double d);
-    void value(const char* value);
+    void value(float f);
+    void value(const char* value, size_t size);
     //
     void startObject();
     void endObject();
@@ -38,28 +49,37 @@ public:
 
     void separation() {
         if (!stack_.empty() && stack_.back().first == NULL_TYPE) {
-            comma(str_);
+            comma();
         }
     }
-    // :
-    void colon(std::string& str) const;
     // ,
-    void comma(std::string& str) const;
+    void comma() const;
     // {
-    void leftBrace(std::string& str) const;
+    void leftBrace() const;
     // }
-    void rightBrace(std::string& str, int32_t layer) const;
+    void rightBrace(int32_t layer) const;
     // [
-    void leftBracket(std::string& str) const;
+    void leftBracket() const;
     // ]
-    void rightBracket(std::string& str, int32_t layer) const;
+    void rightBracket(int32_t layer) const;
     // \t
-    void tab(std::string& str, int32_t layer) const;
+    void tab(int32_t layer) const;
 
-    bool result() const { return stack_.empty(); }
+    // about size more bytes are coming
+    void expect(size_t size) { sink_.expect(size); }
+    // bytes written so far
+    size_t size() const { return sink_.size(); }
+    // text written elsewhere, as it is
+    void write(const char* data, size_t size) { sink_.write(data, size); }
+    // the document is complete and handed to the sink
+    bool result() { return stack_.empty() && sink_.flush(); }
 
 private:
-    void appendString(std::string& str, const char* value);
+    // quoted and escaped
+    static void appendString(OutputSink& sink, const char* value, size_t size);
+    // formatted straight into the sink when it has room for the longest number
+    template <typename T>
+    void appendNumber(T value);
 };
 
 }// namespace json
@@ -0,0 +1,137 @@
+#include <string.h>
+#include "key_index.h"
+
+namespace serialflex {
+
+static inline uint8_t foldCase(const uint8_t c) {
+    return ('A' <= c && c <= 'Z') ? (uint8_t)(c + ('a' - 'A')) : c;
+}
+
+bool KeyIndex::equal(const char* key, const char* name, uint32_t size, bool case_insensitive) {
+    if (!case_insensitive) {
+        return memcmp(key, name, size) == 0;
+    }
+    for (uint32_t idx = 0; idx < size; ++idx) {
+        if (foldCase((uint8_t)key[idx]) != foldCase((uint8_t)name[idx])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// FNV-1a, over folded bytes when case does not matter
+uint32_t KeyIndex::hash(const char* key, uint32_t size, bool case_insensitive) {
+    uint32_t value = 2166136261U;
+    for (uint32_t idx = 0; idx < size; ++idx) {
+        const uint8_t c = (uint8_t)key[idx];
+        value = (value ^ (case_insensitive ? foldCase(c) : c)) * 16777619U;
+    }
+    return value;
+}
+
+// power of two, at most half full
+uint32_t KeyIndex::tableSize(uint32_t children) {
+    uint32_t size = 16;
+    while (size < children * 2) {
+        size <<= 1;
+    }
+    return size;
+}
+
+uint32_t KeyIndex::build(const Tape& tape, const char* src, const TapeNode* object,
+                         bool case_insensitive) {
+    const TapeNode* root = tape.root();
+    const uint32_t first = (uint32_t)slots_.size();
+    const uint32_t mask = tableSize(object->childCount()) - 1;
+    const Slot empty = {0, 0};
+    slots_.resize(first + mask + 1, empty);
+
+    for (const TapeNode* child = object->child(); child; child = child->next()) {
+        const uint32_t key_size = child->keySize();
+        if (!key_size) {
+            continue;
+        }
+        const char* key = src + child->key;
+        const uint32_t value = hash(key, key_size, case_insensitive);
+        for (uint32_t pos = value & mask;; pos = (pos + 1) & mask) {
+            Slot& slot = slots_[first + pos];
+            if (!slot.node) {
+                slot.hash = value;
+                slot.node = (uint32_t)(child - root) + 1;
+                break;
+            }
+            // a repeated key keeps resolving to its first occurrence
+            const TapeNode& other = root[slot.node - 1];
+            if (slot.hash == value && other.keySize() == key_size &&
+                equal(src + other.key, key, key_size, case_insensitive)) {
+                break;
+            }
+        }
+    }
+    return first;
+}
+
+static inline uint32_t objectHash(uint32_t object) {
+    return (uint32_t)(((uint64_t)object * 0x9E3779B97F4A7C15ULL) >> 32);
+}
+
+// at most half full, like the key tables
+void KeyIndex::growTables() {
+    std::vector<Table> tables(tables_.empty() ? 16 : tables_.size() * 2);
+    const uint32_t mask = (uint32_t)tables.size() - 1;
+    for (size_t idx = 0; idx < tables_.size(); ++idx) {
+        const Table& entry = tables_[idx];
+        if (!entry.object) {
+            continue;
+        }
+        uint32_t pos = objectHash(entry.object) & mask;
+        while (tables[pos].object) {
+            pos = (pos + 1) & mask;
+        }
+        tables[pos] = entry;
+    }
+    tables_.swap(tables);
+}
+
+uint32_t KeyIndex::table(const Tape& tape, const char* src, const TapeNode* object,
+                         bool case_insensitive) {
+    if ((table_count_ + 1) * 2 > tables_.size()) {
+        growTables();
+    }
+    const uint32_t node = (uint32_t)(object - tape.root()) + 1;
+    const uint32_t mask = (uint32_t)tables_.size() - 1;
+    for (uint32_t pos = objectHash(node) & mask;; pos = (pos + 1) & mask) {
+        Table& entry = tables_[pos];
+        if (!entry.object) {
+            entry.object = node;
+            entry.case_insensitive = case_insensitive;
+            entry.first = build(tape, src, object, case_insensitive);
+            ++table_count_;
+            return entry.first;
+        }
+        if (entry.object == node && entry.case_insensitive == (uint32_t)case_insensitive) {
+            return entry.first;
+        }
+    }
+}
+
+const TapeNode* KeyIndex::find(const Tape& tape, const char* src, const TapeNode* object,
+                               const char* name, uint32_t name_size, bool case_insensitive) {
+    const TapeNode* root = tape.root();
+    const uint32_t first = table(tape, src, object, case_insensitive);
+    const uint32_t mask = tableSize(object->childCount()) - 1;
+    const uint32_t value = hash(name, name_size, case_insensitive);
+    for (uint32_t pos = value & mask;; pos = (pos + 1) & mask) {
+        const Slot& slot = slots_[first + pos];
+        if (!slot.node) {
+            return NULL;
+        }
+        const TapeNode& node = root[slot.node - 1];
+        if (slot.hash == value && node.keySize() == name_size &&
+            equal(src + node.key, name, name_size, case_insensitive)) {
+            return &node;
+        }
+    }
+}
+
+}// namespace serialflex
@@ -0,0 +1,64 @@
+#ifndef __KEY_INDEX_H__
+#define __KEY_INDEX_H__
+
+#include <stdint.h>
+#include <vector>
+#include "tape.h"
+
+namespace serialflex {
+
+// Hash tables over the keys of wide objects, built the first time a field of the object is
+// looked up and dropped with the tape. Narrow objects are cheaper to scan. The tables are found
+// through a hash of the objects indexed so far, so the cost follows those objects and not the
+// size of the tape.
+class KeyIndex {
+    struct Slot {
+        uint32_t hash;
+        uint32_t node;// tape index of the child + 1, 0 when empty
+    };
+    struct Table {
+        uint32_t object;// tape index of the object + 1, 0 when empty
+        uint32_t case_insensitive;
+        uint32_t first;// first slot of the table
+    };
+
+    std::vector<Slot> slots_;
+    std::vector<Table> tables_;
+    uint32_t table_count_;
+
+    KeyIndex(const KeyIndex&);
+    KeyIndex& operator=(const KeyIndex&);
+
+public:
+    // below about two dozen keys the scan beats building a table, even when each is looked up
+    enum { MIN_CHILDREN = 24 };
+
+    KeyIndex(): table_count_(0) {}
+
+    void clear() {
+        slots_.clear();
+        tables_.clear();
+        table_count_ = 0;
+    }
+
+    // first child of object whose key is name, object has MIN_CHILDREN children or more
+    const TapeNode* find(const Tape& tape, const char* src, const TapeNode* object,
+                         const char* name, uint32_t name_size, bool case_insensitive);
+
+    // key comparison shared with the scan over narrow objects
+    static bool equal(const char* key, const char* name, uint32_t size, bool case_insensitive);
+
+private:
+    // first slot of the table of object, built when it is not yet
+    uint32_t table(const Tape& tape, const char* src, const TapeNode* object,
+                   bool case_insensitive);
+    void growTables();
+    uint32_t build(const Tape& tape, const char* src, const TapeNode* object,
+                   bool case_insensitive);
+    static uint32_t hash(const char* key, uint32_t size, bool case_insensitive);
+    static uint32_t tableSize(uint32_t children);
+};
+
+}// namespace serialflex
+
+#endif
@@ -0,0 +1,53 @@
+#include <string.h>
+#include "key_tokens.h"
+
+namespace serialflex {
+
+const KeyTokens::Key* KeyTokens::lookup(const char* name) const {
+    if (slots_.empty()) {
+        return NULL;
+    }
+    const uint32_t mask = (uint32_t)slots_.size() - 1;
+    for (uint32_t idx = slot(name) & mask;; idx = (idx + 1) & mask) {
+        if (!slots_[idx]) {
+            return NULL;
+        }
+        const Key& key = keys_[slots_[idx] - 1];
+        if (key.name == name) {
+            // strncmp stops at the end of a shorter name
+            if (strncmp(text_.data() + key.offset, name, key.size) == 0 && !name[key.size]) {
+                return &key;
+            }
+            return NULL;
+        }
+    }
+}
+
+void KeyTokens::insert(const char* name, uint32_t size, const std::string* tokens,
+                       uint32_t count) {
+    if (keys_.size() >= MAX_KEYS || count > MAX_TOKENS) {
+        return;
+    }
+    if (slots_.empty()) {
+        // at most half full
+        slots_.resize(MAX_KEYS * 2, 0);
+    }
+    const uint32_t mask = (uint32_t)slots_.size() - 1;
+    uint32_t idx = slot(name) & mask;
+    for (; slots_[idx]; idx = (idx + 1) & mask) {
+        if (keys_[slots_[idx] - 1].name == name) {
+            // the address holds other text now, the first one keeps it
+            return;
+        }
+    }
+    Key key = {name, (uint32_t)text_.size(), size, {0, 0}};
+    text_.append(name, size);
+    for (uint32_t token = 0; token < count; ++token) {
+        key.token_sizes[token] = (uint32_t)tokens[token].size();
+        text_.append(tokens[token]);
+    }
+    keys_.push_back(key);
+    slots_[idx] = (uint16_t)keys_.size();
+}
+
+}// namespace serialflex
@@ -0,0 +1,78 @@
+#ifndef __KEY_TOKENS_H__
+#define __KEY_TOKENS_H__
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace serialflex {
+
+// Field names rendered the way an encoder writes them, such as "name": or <name>, found by the
+// address of the name. Names are nearly always literals, so the first object renders them and
+// every later one copies them out. A copy of the name is compared on each lookup, a buffer
+// reused for other text (a map key) is rendered again rather than mixed up. Names that come
+// after MAX_KEYS others are not kept. A name is stored only once it repeats, so a writer that
+// puts out a single object renders its names in place and allocates nothing here.
+class KeyTokens {
+    struct Key {
+        const char* name;
+        uint32_t offset;// of the copy of the name in text_, the tokens follow it
+        uint32_t size;  // of the name
+        uint32_t token_sizes[2];
+    };
+
+    enum { SEEN_SLOTS = 16 };
+
+    std::vector<Key> keys_;
+    std::vector<uint16_t> slots_;// by address of the name: index in keys_ + 1, 0 when empty
+    std::string text_;
+    // names met once, by address; a collision only delays storing a name
+    const char* seen_[SEEN_SLOTS];
+
+    KeyTokens(const KeyTokens&);
+    KeyTokens& operator=(const KeyTokens&);
+
+public:
+    enum { MAX_KEYS = 256, MAX_TOKENS = 2 };
+
+    KeyTokens() { memset(seen_, 0, sizeof(seen_)); }
+
+    // token index of name, NULL when it has not been stored
+    const char* find(const char* name, uint32_t index, uint32_t& size) const {
+        const Key* key = lookup(name);
+        if (!key) {
+            return NULL;
+        }
+        const char* token = text_.data() + key->offset + key->size;
+        for (uint32_t idx = 0; idx < index; ++idx) {
+            token += key->token_sizes[idx];
+        }
+        size = key->token_sizes[index];
+        return token;
+    }
+
+    // false the first time name is met, the tokens are then not worth storing yet
+    bool repeated(const char* name) {
+        const char*& seen = seen_[slot(name) % SEEN_SLOTS];
+        if (seen == name) {
+            return true;
+        }
+        seen = name;
+        return false;
+    }
+
+    // stores count tokens for name of size bytes, dropped when the table is full
+    void insert(const char* name, uint32_t size, const std::string* tokens, uint32_t count);
+
+private:
+    const Key* lookup(const char* name) const;
+    uint32_t slot(const char* name) const {
+        const uint64_t hash = (uint64_t)(uintptr_t)name * 0x9E3779B97F4A7C15ULL;
+        return (uint32_t)(hash >> 32);
+    }
+};
+
+}// namespace serialflex
+
+#endif
@@ -30,25 +30,49 @@ struct GenericNode {
     uint32_t number;
 };
 
+// Chunked arena: nodes never move once handed out, so a reader can link the tree
+// while it tokenizes and needs no counting pass. clear() keeps the chunks for reuse.
 template <class T>
 class GenericNodeAllocator {
-    uint32_t cur_ndex_;
-    uint32_t capacity_;
-    std::vector<T>& array_;
+    enum { kMinChunkSize = 64, kMaxChunkSize = 64 * 1024 };
+
+    std::vector<T*> chunks_;
+    uint32_t cur_chunk_;
+    uint32_t cur_index_;
+
+    GenericNodeAllocator(const GenericNodeAllocator&);
+    GenericNodeAllocator& operator=(const GenericNodeAllocator&);
 
 public:
-    explicit GenericNodeAllocator(std::vector<T>& vec): cur_ndex_(0), capacity_(0), array_(vec) {}
-    void operator++() { ++capacity_; }
-    void reSize() {
-        assert(array_.empty());
-        array_.resize(capacity_);
+    GenericNodeAllocator(): cur_chunk_(0), cur_index_(0) {}
+    ~GenericNodeAllocator() {
+        for (typename std::vector<T*>::iterator it = chunks_.begin(); it != chunks_.end(); ++it) {
+            delete[] *it;
+        }
+    }
+    void clear() {
+        cur_chunk_ = 0;
+        cur_index_ = 0;
     }
     T* allocValue() {
-        if (array_.empty()) {
-            return NULL;
+        if (chunks_.empty() || cur_index_ == chunkSize(cur_chunk_)) {
+            if (!chunks_.empty()) {
+                ++cur_chunk_;
+                cur_index_ = 0;
+            }
+            if (cur_chunk_ == chunks_.size()) {
+                chunks_.push_back(new T[chunkSize(cur_chunk_)]);
+            }
         }
-        assert(cur_ndex_ < array_.size());
-        return &array_.at(cur_ndex_++);
+        T* value = chunks_[cur_chunk_] + cur_index_++;
+        *value = T();
+        return value;
+    }
+
+private:
+    static uint32_t chunkSize(const uint32_t chunk) {
+        // grow geometrically so large documents need few chunks
+        return (chunk < 10) ? ((uint32_t)kMinChunkSize << chunk) : (uint32_t)kMaxChunkSize;
     }
 };
 
@@ -0,0 +1,765 @@
+#include <float.h>
+#include <string.h>
+#include "reader.h"
+#include "pow10.h"
+#include "../simd.h"
+
+namespace serialflex {
+
+namespace number {
+
+// layout of an ieee 754 binary format
+struct FloatInfo {
+    uint32_t mant_bits;
+    uint32_t exp_bits;
+    int32_t bias;
+};
+
+static const FloatInfo kFloat64Info = {52, 11, -1023};
+static const FloatInfo kFloat32Info = {23, 8, -127};
+
+/*------------------------------------------------------------------------------*/
+// parsed form of the input: value = mantissa * 10^exp10, mantissa keeps at most 19 digits
+
+struct Decomposed {
+    uint64_t mantissa;
+    int32_t exp10;
+    bool negative;
+    bool truncated;
+};
+
+enum { MAX_MANTISSA_DIGITS = 19, MAX_EXPONENT = 10000 };
+
+static inline bool isDigit(char c) { return '0' <= c && c <= '9'; }
+
+static inline char toLower(char c) { return ('A' <= c && c <= 'Z') ? (char)(c + 32) : c; }
+
+static bool equalsIgnoreCase(const char* str, uint32_t length, const char* word) {
+    uint32_t idx = 0;
+    for (; idx < length && word[idx]; ++idx) {
+        if (toLower(str[idx]) != word[idx]) {
+            return false;
+        }
+    }
+    return idx == length && !word[idx];
+}
+
+// inf, infinity and nan, as written by printf
+static bool parseSpecial(const char* str, uint32_t length, bool& negative, bool& nan) {
+    negative = false;
+    if (length && (str[0] == '-' || str[0] == '+')) {
+        negative = (str[0] == '-');
+        ++str;
+        --length;
+    }
+    nan = equalsIgnoreCase(str, length, "nan");
+    return nan || equalsIgnoreCase(str, length, "inf") ||
+           equalsIgnoreCase(str, length, "infinity");
+}
+
+// splits the exponent part off [str + idx, str + length), returns false if it is malformed
+static bool readExponent(const char* str, uint32_t length, uint32_t idx, int32_t& exp10) {
+    exp10 = 0;
+    if (idx == length) {
+        return true;
+    }
+    if (str[idx] != 'e' && str[idx] != 'E') {
+        return false;
+    }
+    ++idx;
+    int32_t sign = 1;
+    if (idx < length && (str[idx] == '-' || str[idx] == '+')) {
+        sign = (str[idx] == '-') ? -1 : 1;
+        ++idx;
+    }
+    if (idx == length) {
+        return false;
+    }
+    for (; idx < length; ++idx) {
+        if (!isDigit(str[idx])) {
+            return false;
+        }
+        if (exp10 < MAX_EXPONENT) {
+            exp10 = exp10 * 10 + (str[idx] - '0');
+        }
+    }
+    exp10 *= sign;
+    return true;
+}
+
+static bool decompose(const char* str, uint32_t length, Decomposed& number) {
+    number.mantissa = 0;
+    number.exp10 = 0;
+    number.negative = false;
+    number.truncated = false;
+
+    uint32_t idx = 0;
+    if (idx < length && (str[idx] == '-' || str[idx] == '+')) {
+        number.negative = (str[idx] == '-');
+        ++idx;
+    }
+
+    bool saw_dot = false, saw_digits = false;
+    int32_t digits = 0, mantissa_digits = 0, decimal_point = 0;
+    for (; idx < length; ++idx) {
+        const char c = str[idx];
+        if (c == '.') {
+            if (saw_dot) {
+                return false;
+            }
+            saw_dot = true;
+            decimal_point = digits;
+        } else if (isDigit(c)) {
+            saw_digits = true;
+            if (c == '0' && digits == 0) {
+                // leading zeros only move the decimal point
+                --decimal_point;
+                continue;
+            }
+            ++digits;
+            if (mantissa_digits < MAX_MANTISSA_DIGITS) {
+                number.mantissa = number.mantissa * 10 + (uint64_t)(c - '0');
+                ++mantissa_digits;
+            } else if (c != '0') {
+                number.truncated = true;
+            }
+        } else {
+            break;
+        }
+    }
+    if (!saw_digits) {
+        return false;
+    }
+    if (!saw_dot) {
+        decimal_point = digits;
+    }
+
+    int32_t exp10 = 0;
+    if (!readExponent(str, length, idx, exp10)) {
+        return false;
+    }
+    if (number.mantissa) {
+        number.exp10 = decimal_point + exp10 - mantissa_digits;
+    }
+    return true;
+}
+
+/*------------------------------------------------------------------------------*/
+// exact fast path: both the mantissa and the power of ten are exactly representable
+
+// x87 keeps intermediates in extended precision, which would round twice
+#if !defined(FLT_EVAL_METHOD) || FLT_EVAL_METHOD == 0 || FLT_EVAL_METHOD == -1
+#define SERIALFLEX_EXACT_FLOAT 1
+#endif
+
+static bool exactDouble(const Decomposed& number, double& value) {
+#ifdef SERIALFLEX_EXACT_FLOAT
+    static const double kPow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                    1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                    1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    uint64_t mantissa = number.mantissa;
+    int32_t exp10 = number.exp10;
+    // trailing zeros such as the padding of "%f" only scale the mantissa
+    while (mantissa >> 52 && mantissa % 10 == 0) {
+        mantissa /= 10;
+        ++exp10;
+    }
+    if (number.truncated || mantissa >> 52) {
+        return false;
+    }
+    double f = (double)mantissa;
+    if (number.negative) {
+        f = -f;
+    }
+    if (exp10 == 0) {
+        value = f;
+        return true;
+    } else if (exp10 > 0 && exp10 <= 15 + 22) {
+        // the surplus over 10^22 is moved into the mantissa while it stays exact
+        if (exp10 > 22) {
+            f *= kPow10[exp10 - 22];
+            exp10 = 22;
+        }
+        if (f > 1e15 || f < -1e15) {
+            return false;
+        }
+        value = f * kPow10[exp10];
+        return true;
+    } else if (exp10 < 0 && exp10 >= -22) {
+        value = f / kPow10[-exp10];
+        return true;
+    }
+#endif
+    return false;
+}
+
+static bool exactFloat(const Decomposed& number, float& value) {
+#ifdef SERIALFLEX_EXACT_FLOAT
+    static const float kPow10[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f,
+                                   1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+    uint64_t mantissa = number.mantissa;
+    int32_t exp10 = number.exp10;
+    while (mantissa >> 23 && mantissa % 10 == 0) {
+        mantissa /= 10;
+        ++exp10;
+    }
+    if (number.truncated || mantissa >> 23) {
+        return false;
+    }
+    float f = (float)mantissa;
+    if (number.negative) {
+        f = -f;
+    }
+    if (exp10 == 0) {
+        value = f;
+        return true;
+    } else if (exp10 > 0 && exp10 <= 7 + 10) {
+        if (exp10 > 10) {
+            f *= kPow10[exp10 - 10];
+            exp10 = 10;
+        }
+        if (f > 1e7f || f < -1e7f) {
+            return false;
+        }
+        value = f * kPow10[exp10];
+        return true;
+    } else if (exp10 < 0 && exp10 >= -10) {
+        value = f / kPow10[-exp10];
+        return true;
+    }
+#endif
+    return false;
+}
+
+/*------------------------------------------------------------------------------*/
+// Eisel-Lemire: one or two 64x64 multiplications against the truncated 128-bit power of ten,
+// gives up when the truncation could change the rounding
+
+static bool eiselLemire(uint64_t mantissa, int32_t exp10, bool negative, const FloatInfo& info,
+                        uint64_t& bits) {
+    const uint32_t mant_bits = info.mant_bits;
+    const uint64_t max_exp = (1ULL << info.exp_bits) - 1;
+    const uint64_t sign_bit = (uint64_t)negative << (mant_bits + info.exp_bits);
+    if (!mantissa) {
+        bits = sign_bit;
+        return true;
+    }
+    if (exp10 < POW10_MIN_EXP10 || exp10 > POW10_MAX_EXP10) {
+        return false;
+    }
+
+    const uint32_t clz = simd::leadingZeros(mantissa);
+    mantissa <<= clz;
+    // floor(log2(10^exp10)) == (217706 * exp10) >> 16 over the table range
+    uint64_t ret_exp2 = (uint64_t)(((217706 * exp10) >> 16) + 64 - info.bias) - clz;
+
+    const uint64_t* pow10 = kPow10Mantissa[exp10 - POW10_MIN_EXP10];
+    const uint32_t shift = 64 - mant_bits - 3;
+    const uint64_t low_mask = (1ULL << shift) - 1;
+    uint64_t x_hi = 0;
+    uint64_t x_lo = multiply(mantissa, pow10[1], x_hi);
+    if ((x_hi & low_mask) == low_mask && x_lo + mantissa < mantissa) {
+        // the low half of the power may carry into the bits that decide the rounding
+        uint64_t y_hi = 0;
+        const uint64_t y_lo = multiply(mantissa, pow10[0], y_hi);
+        uint64_t merged_hi = x_hi, merged_lo = x_lo + y_hi;
+        if (merged_lo < x_lo) {
+            ++merged_hi;
+        }
+        if ((merged_hi & low_mask) == low_mask && merged_lo + 1 == 0 &&
+            y_lo + mantissa < mantissa) {
+            return false;
+        }
+        x_hi = merged_hi;
+        x_lo = merged_lo;
+    }
+
+    const uint64_t msb = x_hi >> 63;
+    uint64_t ret_mantissa = x_hi >> (msb + shift);
+    ret_exp2 -= 1 ^ msb;
+
+    // exactly halfway between two floats: leave ties to the exact path
+    if (x_lo == 0 && (x_hi & low_mask) == 0 && (ret_mantissa & 3) == 1) {
+        return false;
+    }
+
+    ret_mantissa += ret_mantissa & 1;
+    ret_mantissa >>= 1;
+    if (ret_mantissa >> (mant_bits + 1)) {
+        ret_mantissa >>= 1;
+        ++ret_exp2;
+    }
+    // subnormal, infinite and nan results are left to the exact path
+    if (ret_exp2 - 1 >= max_exp - 1) {
+        return false;
+    }
+    bits = (ret_exp2 << mant_bits) | (ret_mantissa & ((1ULL << mant_bits) - 1)) | sign_bit;
+    return true;
+}
+
+/*------------------------------------------------------------------------------*/
+// exact fallback: arbitrary precision decimal, shifted by powers of two until it is in range
+
+enum { DECIMAL_MAX_DIGITS = 800, DECIMAL_MAX_SHIFT = 60 };
+
+struct Decimal {
+    uint8_t digits[DECIMAL_MAX_DIGITS];
+    int32_t count;        // number of digits used
+    int32_t point;        // decimal point position, relative to the first digit
+    bool negative;
+    bool truncated;       // nonzero digits were dropped past DECIMAL_MAX_DIGITS
+};
+
+static void trimDecimal(Decimal& d) {
+    while (d.count > 0 && d.digits[d.count - 1] == 0) {
+        --d.count;
+    }
+    if (d.count == 0) {
+        d.point = 0;
+    }
+}
+
+static bool setDecimal(const char* str, uint32_t length, Decimal& d) {
+    d.count = 0;
+    d.point = 0;
+    d.negative = false;
+    d.truncated = false;
+
+    uint32_t idx = 0;
+    if (idx < length && (str[idx] == '-' || str[idx] == '+')) {
+        d.negative = (str[idx] == '-');
+        ++idx;
+    }
+
+    bool saw_dot = false, saw_digits = false;
+    for (; idx < length; ++idx) {
+        const char c = str[idx];
+        if (c == '.') {
+            if (saw_dot) {
+                return false;
+            }
+            saw_dot = true;
+            d.point = d.count;
+        } else if (isDigit(c)) {
+            saw_digits = true;
+            if (c == '0' && d.count == 0) {
+                --d.point;
+                continue;
+            }
+            if (d.count < DECIMAL_MAX_DIGITS) {
+                d.digits[d.count++] = (uint8_t)(c - '0');
+            } else if (c != '0') {
+                d.truncated = true;
+            }
+        } else {
+            break;
+        }
+    }
+    if (!saw_digits) {
+        return false;
+    }
+    if (!saw_dot) {
+        d.point = d.count;
+    }
+
+    int32_t exp10 = 0;
+    if (!readExponent(str, length, idx, exp10)) {
+        return false;
+    }
+    d.point += exp10;
+    trimDecimal(d);
+    return true;
+}
+
+// d *= 2^k
+static void leftShift(Decimal& d, uint32_t k) {
+    uint8_t buffer[DECIMAL_MAX_DIGITS + 20];
+    int32_t write = (int32_t)sizeof(buffer);
+    uint64_t n = 0;
+    for (int32_t read = d.count - 1; read >= 0; --read) {
+        n += (uint64_t)d.digits[read] << k;
+        buffer[--write] = (uint8_t)(n % 10);
+        n /= 10;
+    }
+    while (n > 0) {
+        buffer[--write] = (uint8_t)(n % 10);
+        n /= 10;
+    }
+
+    const int32_t total = (int32_t)sizeof(buffer) - write;
+    d.point += total - d.count;
+    d.count = 0;
+    for (int32_t idx = 0; idx < total; ++idx) {
+        if (d.count < DECIMAL_MAX_DIGITS) {
+            d.digits[d.count++] = buffer[write + idx];
+        } else if (buffer[write + idx] != 0) {
+            d.truncated = true;
+        }
+    }
+    trimDecimal(d);
+}
+
+// d /= 2^k
+static void rightShift(Decimal& d, uint32_t k) {
+    int32_t read = 0, write = 0;
+    uint64_t n = 0;
+    for (; (n >> k) == 0; ++read) {
+        if (read >= d.count) {
+            if (n == 0) {
+                d.count = 0;
+                return;
+            }
+            while ((n >> k) == 0) {
+                n *= 10;
+                ++read;
+            }
+            break;
+        }
+        n = n * 10 + d.digits[read];
+    }
+    d.point -= read - 1;
+
+    const uint64_t mask = (1ULL << k) - 1;
+    for (; read < d.count; ++read) {
+        const uint64_t digit = n >> k;
+        n &= mask;
+        d.digits[write++] = (uint8_t)digit;
+        n = n * 10 + d.digits[read];
+    }
+    while (n > 0) {
+        const uint64_t digit = n >> k;
+        n &= mask;
+        if (write < DECIMAL_MAX_DIGITS) {
+            d.digits[write++] = (uint8_t)digit;
+        } else if (digit > 0) {
+            d.truncated = true;
+        }
+        n *= 10;
+    }
+    d.count = write;
+    trimDecimal(d);
+}
+
+static void shiftDecimal(Decimal& d, int32_t k) {
+    if (d.count == 0) {
+        return;
+    }
+    if (k > 0) {
+        for (; k > DECIMAL_MAX_SHIFT; k -= DECIMAL_MAX_SHIFT) {
+            leftShift(d, DECIMAL_MAX_SHIFT);
+        }
+        leftShift(d, (uint32_t)k);
+    } else if (k < 0) {
+        for (; k < -DECIMAL_MAX_SHIFT; k += DECIMAL_MAX_SHIFT) {
+            rightShift(d, DECIMAL_MAX_SHIFT);
+        }
+        rightShift(d, (uint32_t)-k);
+    }
+}
+
+// round half to even at the decimal point, dropped digits count as above half
+static bool shouldRoundUp(const Decimal& d, int32_t nd) {
+    if (nd < 0 || nd >= d.count) {
+        return false;
+    }
+    if (d.digits[nd] == 5 && nd + 1 == d.count) {
+        if (d.truncated) {
+            return true;
+        }
+        return nd > 0 && (d.digits[nd - 1] & 1);
+    }
+    return d.digits[nd] >= 5;
+}
+
+static uint64_t roundedInteger(const Decimal& d) {
+    if (d.point > 20) {
+        return 0xFFFFFFFFFFFFFFFFULL;
+    }
+    int32_t idx = 0;
+    uint64_t n = 0;
+    for (; idx < d.point && idx < d.count; ++idx) {
+        n = n * 10 + d.digits[idx];
+    }
+    for (; idx < d.point; ++idx) {
+        n *= 10;
+    }
+    if (shouldRoundUp(d, d.point)) {
+        ++n;
+    }
+    return n;
+}
+
+static uint64_t decimalToBits(Decimal& d, const FloatInfo& info) {
+    // binary exponent reached by shifting 10^i
+    static const int32_t kPowTab[] = {1, 3, 6, 9, 13, 16, 19, 23, 26};
+    static const int32_t kPowTabSize = (int32_t)(sizeof(kPowTab) / sizeof(kPowTab[0]));
+    const int32_t max_exp = (1 << info.exp_bits) - 1;
+
+    int32_t exp = 0;
+    uint64_t mantissa = 0;
+    bool overflow = false;
+    if (d.count == 0 || d.point < -330) {
+        exp = info.bias;
+    } else if (d.point > 310) {
+        overflow = true;
+    } else {
+        // scale to [0.5, 1)
+        while (d.point > 0) {
+            const int32_t n = d.point >= kPowTabSize ? 27 : kPowTab[d.point];
+            shiftDecimal(d, -n);
+            exp += n;
+        }
+        while (d.point < 0 || (d.point == 0 && d.digits[0] < 5)) {
+            const int32_t n = -d.point >= kPowTabSize ? 27 : kPowTab[-d.point];
+            shiftDecimal(d, n);
+            exp -= n;
+        }
+        // to [1, 2), the smallest exponent means denormal
+        --exp;
+        if (exp < info.bias + 1) {
+            const int32_t n = info.bias + 1 - exp;
+            shiftDecimal(d, -n);
+            exp += n;
+        }
+        if (exp - info.bias >= max_exp) {
+            overflow = true;
+        } else {
+            shiftDecimal(d, (int32_t)(1 + info.mant_bits));
+            mantissa = roundedInteger(d);
+            if (mantissa == (2ULL << info.mant_bits)) {
+                // rounding carried out of the mantissa
+                mantissa >>= 1;
+                ++exp;
+                if (exp - info.bias >= max_exp) {
+                    overflow = true;
+                }
+            }
+            if (!(mantissa & (1ULL << info.mant_bits))) {
+                exp = info.bias;
+            }
+        }
+    }
+    if (overflow) {
+        // infinity
+        mantissa = 0;
+        exp = max_exp + info.bias;
+    }
+
+    uint64_t bits = mantissa & ((1ULL << info.mant_bits) - 1);
+    bits |= (uint64_t)((exp - info.bias) & max_exp) << info.mant_bits;
+    if (d.negative) {
+        bits |= 1ULL << info.mant_bits << info.exp_bits;
+    }
+    return bits;
+}
+
+/*------------------------------------------------------------------------------*/
+// integers: eight digits per step while they are available, overflow checked on the last digit
+
+// SWAR needs the first character in the low byte
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define SERIALFLEX_SWAR_DIGITS 1
+#endif
+
+enum { MAX_UINT64_DIGITS = 20 };
+
+#ifdef SERIALFLEX_SWAR_DIGITS
+static inline uint64_t loadEight(const char* str) {
+    uint64_t value = 0;
+    memcpy(&value, str, sizeof(value));
+    return value;
+}
+
+static inline bool isEightDigits(uint64_t value) {
+    return ((value & 0xF0F0F0F0F0F0F0F0ULL) |
+            (((value + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) ==
+           0x3333333333333333ULL;
+}
+
+// "12345678" -> 12345678: pairs, then quads, then both halves in one multiplication
+static inline uint32_t parseEightDigits(uint64_t value) {
+    const uint64_t mask = 0x000000FF000000FFULL;
+    const uint64_t mul1 = 0x000F424000000064ULL;// 100 + (1000000 << 32)
+    const uint64_t mul2 = 0x0000271000000001ULL;// 1 + (10000 << 32)
+    value -= 0x3030303030303030ULL;
+    value = (value * 10) + (value >> 8);
+    value = (((value & mask) * mul1) + (((value >> 16) & mask) * mul2)) >> 32;
+    return (uint32_t)value;
+}
+#endif
+
+static bool parseMagnitude(const char* str, uint32_t length, uint64_t& magnitude, bool& negative) {
+    uint32_t idx = 0;
+    negative = false;
+    if (idx < length && (str[idx] == '-' || str[idx] == '+')) {
+        negative = (str[idx] == '-');
+        ++idx;
+    }
+    if (idx == length) {
+        return false;
+    }
+    // leading zeros do not count against the width
+    while (idx < length && str[idx] == '0') {
+        ++idx;
+    }
+
+    uint64_t value = 0;
+    uint32_t digits = 0;
+#ifdef SERIALFLEX_SWAR_DIGITS
+    while (length - idx >= 8 && digits + 8 < MAX_UINT64_DIGITS) {
+        const uint64_t chunk = loadEight(str + idx);
+        if (!isEightDigits(chunk)) {
+            break;
+        }
+        value = value * 100000000 + parseEightDigits(chunk);
+        digits += 8;
+        idx += 8;
+    }
+#endif
+    for (; idx < length; ++idx, ++digits) {
+        if (!isDigit(str[idx])) {
+            return false;
+        }
+        const uint64_t digit = (uint64_t)(str[idx] - '0');
+        if (digits + 1 >= MAX_UINT64_DIGITS) {
+            if (digits + 1 > MAX_UINT64_DIGITS || value > (0xFFFFFFFFFFFFFFFFULL - digit) / 10) {
+                return false;
+            }
+        }
+        value = value * 10 + digit;
+    }
+    magnitude = value;
+    return true;
+}
+
+bool parseInt32(const char* str, uint32_t length, int32_t& value) {
+    uint64_t magnitude = 0;
+    bool negative = false;
+    if (!parseMagnitude(str, length, magnitude, negative) ||
+        magnitude > (negative ? 0x80000000ULL : 0x7FFFFFFFULL)) {
+        return false;
+    }
+    value = negative ? (int32_t)(0 - (uint32_t)magnitude) : (int32_t)magnitude;
+    return true;
+}
+
+bool parseInt64(const char* str, uint32_t length, int64_t& value) {
+    uint64_t magnitude = 0;
+    bool negative = false;
+    if (!parseMagnitude(str, length, magnitude, negative) ||
+        magnitude > (negative ? 0x8000000000000000ULL : 0x7FFFFFFFFFFFFFFFULL)) {
+        return false;
+    }
+    value = negative ? (int64_t)(0 - magnitude) : (int64_t)magnitude;
+    return true;
+}
+
+bool parseUint32(const char* str, uint32_t length, uint32_t& value) {
+    uint64_t magnitude = 0;
+    bool negative = false;
+    // "-0" is the only negative value that fits
+    if (!parseMagnitude(str, length, magnitude, negative) || magnitude > 0xFFFFFFFFULL ||
+        (negative && magnitude)) {
+        return false;
+    }
+    value = (uint32_t)magnitude;
+    return true;
+}
+
+bool parseUint64(const char* str, uint32_t length, uint64_t& value) {
+    uint64_t magnitude = 0;
+    bool negative = false;
+    if (!parseMagnitude(str, length, magnitude, negative) || (negative && magnitude)) {
+        return false;
+    }
+    value = magnitude;
+    return true;
+}
+
+/*------------------------------------------------------------------------------*/
+
+bool parseDouble(const char* str, uint32_t length, double& value) {
+    union {
+        uint64_t u64;
+        double db;
+    };
+    Decomposed number;
+    if (!decompose(str, length, number)) {
+        bool negative = false, nan = false;
+        if (!parseSpecial(str, length, negative, nan)) {
+            return false;
+        }
+        u64 = nan ? 0x7FF8000000000000ULL : 0x7FF0000000000000ULL;
+        value = negative ? -db : db;
+        return true;
+    }
+    if (exactDouble(number, value)) {
+        return true;
+    }
+    if (eiselLemire(number.mantissa, number.exp10, number.negative, kFloat64Info, u64)) {
+        if (!number.truncated) {
+            value = db;
+            return true;
+        }
+        // the dropped digits only matter if they reach the next representable value
+        const uint64_t lower = u64;
+        if (eiselLemire(number.mantissa + 1, number.exp10, number.negative, kFloat64Info, u64) &&
+            u64 == lower) {
+            value = db;
+            return true;
+        }
+    }
+    Decimal d;
+    if (!setDecimal(str, length, d)) {
+        return false;
+    }
+    u64 = decimalToBits(d, kFloat64Info);
+    value = db;
+    return true;
+}
+
+bool parseFloat(const char* str, uint32_t length, float& value) {
+    union {
+        uint32_t u32;
+        float f;
+    };
+    Decomposed number;
+    if (!decompose(str, length, number)) {
+        bool negative = false, nan = false;
+        if (!parseSpecial(str, length, negative, nan)) {
+            return false;
+        }
+        u32 = nan ? 0x7FC00000U : 0x7F800000U;
+        value = negative ? -f : f;
+        return true;
+    }
+    if (exactFloat(number, value)) {
+        return true;
+    }
+    uint64_t bits = 0;
+    if (eiselLemire(number.mantissa, number.exp10, number.negative, kFloat32Info, bits)) {
+        if (!number.truncated) {
+            u32 = (uint32_t)bits;
+            value = f;
+            return true;
+        }
+        const uint64_t lower = bits;
+        if (eiselLemire(number.mantissa + 1, number.exp10, number.negative, kFloat32Info, bits) &&
+            bits == lower) {
+            u32 = (uint32_t)bits;
+            value = f;
+            return true;
+        }
+    }
+    Decimal d;
+    if (!setDecimal(str, length, d)) {
+        return false;
+    }
+    u32 = (uint32_t)decimalToBits(d, kFloat32Info);
+    value = f;
+    return true;
+}
+
+}// namespace number
+
+}// namespace serialflex
@@ -0,0 +1,26 @@
+#ifndef __NUMBER_READER_H__
+#define __NUMBER_READER_H__
+
+#include <stdint.h>
+
+namespace serialflex {
+
+namespace number {
+
+// Correctly rounded decimal to binary conversion of exactly [str, str + length):
+// [-+]digits[.digits][(e|E)[-+]digits], or "inf"/"infinity"/"nan" in any case.
+// Independent of the locale; returns false on bad syntax.
+bool parseDouble(const char* str, uint32_t length, double& value);
+bool parseFloat(const char* str, uint32_t length, float& value);
+
+// [-+]digits, returns false on bad syntax or when the value does not fit the target type
+bool parseInt32(const char* str, uint32_t length, int32_t& value);
+bool parseInt64(const char* str, uint32_t length, int64_t& value);
+bool parseUint32(const char* str, uint32_t length, uint32_t& value);
+bool parseUint64(const char* str, uint32_t length, uint64_t& value);
+
+}// namespace number
+
+}// namespace serialflex
+
+#endif
@@ -0,0 +1,270 @@
+#include <string.h>
+#include "writer.h"
+#include "pow10.h"
+
+namespace serialflex {
+
+namespace number {
+
+/*------------------------------------------------------------------------------*/
+// integers: two digits per division, from the last one backwards
+
+static const char kDigitPairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static inline uint32_t countDigits(uint64_t value) {
+    uint32_t count = 1;
+    for (;;) {
+        if (value < 10) {
+            return count;
+        }
+        if (value < 100) {
+            return count + 1;
+        }
+        if (value < 1000) {
+            return count + 2;
+        }
+        if (value < 10000) {
+            return count + 3;
+        }
+        value /= 10000;
+        count += 4;
+    }
+}
+
+static inline void writePair(char*& end, uint32_t pair) {
+    end -= 2;
+    memcpy(end, kDigitPairs + pair * 2, 2);
+}
+
+// the digits of value end at end
+static void writeDigits(char* end, uint64_t value) {
+    // 64-bit divisions are slow, peel off eight digits at a time until 32 bits are left
+    while (value > 0xFFFFFFFFULL) {
+        uint32_t low = (uint32_t)(value % 100000000);
+        value /= 100000000;
+        for (int32_t idx = 0; idx < 4; ++idx) {
+            writePair(end, low % 100);
+            low /= 100;
+        }
+    }
+    uint32_t rest = (uint32_t)value;
+    while (rest >= 100) {
+        writePair(end, rest % 100);
+        rest /= 100;
+    }
+    if (rest >= 10) {
+        writePair(end, rest);
+    } else {
+        *--end = (char)('0' + rest);
+    }
+}
+
+uint32_t formatUint64(uint64_t value, char* buffer) {
+    const uint32_t length = countDigits(value);
+    writeDigits(buffer + length, value);
+    return length;
+}
+
+uint32_t formatInt64(int64_t value, char* buffer) {
+    if (value < 0) {
+        *buffer = '-';
+        return formatUint64(0 - (uint64_t)value, buffer + 1) + 1;
+    }
+    return formatUint64((uint64_t)value, buffer);
+}
+
+/*------------------------------------------------------------------------------*/
+// Schubfach: the interval of decimals that round to the value is scaled by the 128-bit power
+// of ten, the shortest decimal inside it is picked and ties go to the closest one
+
+// g * cp / 2^128 with g the power of ten rounded up, the lowest bit is set when there is a
+// fraction left (round to odd)
+static inline uint64_t roundToOdd(const uint64_t* pow10, uint64_t cp) {
+    const uint64_t g_lo = pow10[0] + 1;
+    const uint64_t g_hi = pow10[1] + (g_lo == 0);
+    uint64_t x_hi = 0;
+    multiply(g_lo, cp, x_hi);
+    uint64_t y_hi = 0;
+    const uint64_t y_lo = multiply(g_hi, cp, y_hi);
+    const uint64_t middle = y_lo + x_hi;
+    if (middle < y_lo) {
+        ++y_hi;
+    }
+    return y_hi | (middle > 1);
+}
+
+// value = c * 2^q, c > 0; gives value ~= digits * 10^exp10 with the fewest digits
+static void shortest(uint64_t c, int32_t q, bool lower_closer, uint64_t& digits,
+                     int32_t& exp10) {
+    const bool even = !(c & 1);
+    const uint64_t cbl = 4 * c - 2 + lower_closer;
+    const uint64_t cb = 4 * c;
+    const uint64_t cbr = 4 * c + 2;
+
+    // floor(log10(3/4 * 2^q)) or floor(log10(2^q)), then 2^h brings the product to 64 bits
+    const int32_t k = lower_closer ? ((q * 631305 - 261663) >> 21) : ((q * 315653) >> 20);
+    const int32_t h = q + ((217706 * -k) >> 16) + 1;
+    const uint64_t* pow10 = kPow10Mantissa[-k - POW10_MIN_EXP10];
+    const uint64_t vbl = roundToOdd(pow10, cbl << h);
+    const uint64_t vb = roundToOdd(pow10, cb << h);
+    const uint64_t vbr = roundToOdd(pow10, cbr << h);
+    const uint64_t lower = vbl + !even;
+    const uint64_t upper = vbr - !even;
+
+    const uint64_t s = vb >> 2;
+    if (s >= 10) {
+        // one digit less when exactly one of its two neighbours is inside
+        const uint64_t sp = s / 10;
+        const bool up_inside = lower <= 40 * sp;
+        const bool wp_inside = 40 * sp + 40 <= upper;
+        if (up_inside != wp_inside) {
+            digits = sp + wp_inside;
+            exp10 = k + 1;
+            return;
+        }
+    }
+    const bool u_inside = lower <= 4 * s;
+    const bool w_inside = 4 * s + 4 <= upper;
+    exp10 = k;
+    if (u_inside != w_inside) {
+        digits = s + w_inside;
+        return;
+    }
+    const uint64_t middle = 4 * s + 2;
+    digits = s + (vb > middle || (vb == middle && (s & 1)));
+}
+
+// sign, digits and decimal point as described in writer.h
+static uint32_t layout(uint64_t digits, int32_t exp10, bool negative, char* buffer) {
+    while (digits >= 10 && digits % 10 == 0) {
+        digits /= 10;
+        ++exp10;
+    }
+    char* ptr = buffer;
+    if (negative) {
+        *ptr++ = '-';
+    }
+    const int32_t count = (int32_t)countDigits(digits);
+    const int32_t point = count + exp10;// value = 0.digits * 10^point
+    if (0 < point && point <= 21) {
+        if (exp10 >= 0) {
+            writeDigits(ptr + count, digits);
+            ptr += count;
+            memset(ptr, '0', exp10);
+            ptr += exp10;
+            memcpy(ptr, ".0", 2);
+            ptr += 2;
+        } else {
+            // the integer part moves one place left to make room for the point
+            writeDigits(ptr + count + 1, digits);
+            memmove(ptr, ptr + 1, point);
+            ptr[point] = '.';
+            ptr += count + 1;
+        }
+    } else if (-6 < point && point <= 0) {
+        memcpy(ptr, "0.", 2);
+        ptr += 2;
+        memset(ptr, '0', -point);
+        ptr += -point;
+        writeDigits(ptr + count, digits);
+        ptr += count;
+    } else {
+        writeDigits(ptr + count + 1, digits);
+        ptr[0] = ptr[1];
+        if (count > 1) {
+            ptr[1] = '.';
+            ptr += count + 1;
+        } else {
+            ptr += 1;
+        }
+        int32_t exponent = point - 1;
+        *ptr++ = 'e';
+        if (exponent < 0) {
+            *ptr++ = '-';
+            exponent = -exponent;
+        } else {
+            *ptr++ = '+';
+        }
+        ptr += formatUint64((uint64_t)exponent, ptr);
+    }
+    return (uint32_t)(ptr - buffer);
+}
+
+// inf, nan and zeros, which have no shortest digits
+static uint32_t special(bool negative, bool nan, bool zero, char* buffer) {
+    const char* text = negative ? "-inf" : "inf";
+    if (nan) {
+        text = "nan";
+    } else if (zero) {
+        text = negative ? "-0.0" : "0.0";
+    }
+    const uint32_t length = (uint32_t)strlen(text);
+    memcpy(buffer, text, length);
+    return length;
+}
+
+uint32_t formatDouble(double value, char* buffer) {
+    uint64_t bits = 0;
+    memcpy(&bits, &value, sizeof(bits));
+    const bool negative = (bits >> 63) != 0;
+    const uint64_t mantissa = bits & ((1ULL << 52) - 1);
+    const uint32_t exponent = (uint32_t)(bits >> 52) & 0x7FF;
+    if (exponent == 0x7FF || (!exponent && !mantissa)) {
+        return special(negative, exponent == 0x7FF && mantissa, !exponent, buffer);
+    }
+
+    uint64_t c = mantissa;
+    int32_t q = 1 - 1075;
+    if (exponent) {
+        c |= 1ULL << 52;
+        q = (int32_t)exponent - 1075;
+        if (-52 <= q && q <= 0 && !(c & ((1ULL << -q) - 1))) {
+            // small integers are exact
+            return layout(c >> -q, 0, negative, buffer);
+        }
+    }
+    uint64_t digits = 0;
+    int32_t exp10 = 0;
+    shortest(c, q, !mantissa && exponent > 1, digits, exp10);
+    return layout(digits, exp10, negative, buffer);
+}
+
+uint32_t formatFloat(float value, char* buffer) {
+    uint32_t bits = 0;
+    memcpy(&bits, &value, sizeof(bits));
+    const bool negative = (bits >> 31) != 0;
+    const uint32_t mantissa = bits & ((1U << 23) - 1);
+    const uint32_t exponent = (bits >> 23) & 0xFF;
+    if (exponent == 0xFF || (!exponent && !mantissa)) {
+        return special(negative, exponent == 0xFF && mantissa, !exponent, buffer);
+    }
+
+    uint64_t c = mantissa;
+    int32_t q = 1 - 150;
+    if (exponent) {
+        c |= 1U << 23;
+        q = (int32_t)exponent - 150;
+        if (-23 <= q && q <= 0 && !(c & ((1ULL << -q) - 1))) {
+            return layout(c >> -q, 0, negative, buffer);
+        }
+    }
+    // the 128-bit powers of ten are more than precise enough for floats
+    uint64_t digits = 0;
+    int32_t exp10 = 0;
+    shortest(c, q, !mantissa && exponent > 1, digits, exp10);
+    return layout(digits, exp10, negative, buffer);
+}
+
+}// namespace number
+
+}// namespace serialflex
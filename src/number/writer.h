@@ -0,0 +1,34 @@
+#ifndef __NUMBER_WRITER_H__
+#define __NUMBER_WRITER_H__
+
+#include <stdint.h>
+
+namespace serialflex {
+
+namespace number {
+
+// longest text written below, "-2.2250738585072014e-308" and "-0.0000012345678901234567" fit
+enum { MAX_NUMBER_SIZE = 32 };
+
+// Decimal text of value at buffer, which holds MAX_NUMBER_SIZE bytes; returns the length,
+// no '\0' is written.
+uint32_t formatInt64(int64_t value, char* buffer);
+uint32_t formatUint64(uint64_t value, char* buffer);
+
+// The shortest text that parses back to exactly value, "inf"/"-inf"/"nan" otherwise. Numbers
+// within 1e-6 <= |value| < 1e21 are written in fixed notation with at least one decimal, the
+// rest as d.ddde[-+]x. Floats are rounded at float precision, 0.1f is written as "0.1".
+uint32_t formatDouble(double value, char* buffer);
+uint32_t formatFloat(float value, char* buffer);
+
+// one name for the functions above
+inline uint32_t formatNumber(int64_t value, char* buffer) { return formatInt64(value, buffer); }
+inline uint32_t formatNumber(uint64_t value, char* buffer) { return formatUint64(value, buffer); }
+inline uint32_t formatNumber(double value, char* buffer) { return formatDouble(value, buffer); }
+inline uint32_t formatNumber(float value, char* buffer) { return formatFloat(value, buffer); }
+
+}// namespace number
+
+}// namespace serialflex
+
+#endif
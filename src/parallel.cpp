@@ -0,0 +1,55 @@
+#include <serialflex/parallel.h>
+#if __cplusplus >= 201103L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201103L)
+#include <atomic>
+#include <thread>
+#include <vector>
+#define SERIALFLEX_THREADS
+#endif
+
+namespace serialflex {
+
+namespace internal {
+
+#ifdef SERIALFLEX_THREADS
+static void takeJobs(std::atomic<size_t>* next, size_t count, ParallelJob job, void* context,
+                     uint32_t worker) {
+    for (size_t idx = (*next)++; idx < count; idx = (*next)++) {
+        job(context, worker, idx);
+    }
+}
+#endif
+
+void parallelFor(size_t count, uint32_t threads, ParallelJob job, void* context) {
+#ifdef SERIALFLEX_THREADS
+    if (threads > count) {
+        threads = (uint32_t)count;
+    }
+    if (threads > 1) {
+        std::atomic<size_t> next(0);
+        std::vector<std::thread> workers;
+        workers.reserve(threads - 1);
+        for (uint32_t idx = 1; idx < threads; ++idx) {
+            try {
+                workers.push_back(std::thread(takeJobs, &next, count, job, context, idx));
+            } catch (...) {
+                // the threads started so far and this one share the jobs
+                break;
+            }
+        }
+        takeJobs(&next, count, job, context, 0);
+        for (size_t idx = 0; idx < workers.size(); ++idx) {
+            workers[idx].join();
+        }
+        return;
+    }
+#else
+    (void)threads;
+#endif
+    for (size_t idx = 0; idx < count; ++idx) {
+        job(context, 0, idx);
+    }
+}
+
+}// namespace internal
+
+}// namespace serialflex
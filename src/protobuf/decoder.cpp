@@ -3,18 +3,35 @@
 
 namespace serialflex {
 
-ProtobufDecoder::ProtobufDecoder(const uint8_t* data, const uint32_t size): reader_(NULL) {
+ProtobufDecoder::ProtobufDecoder(): reader_(NULL), own_reader_(true) {
     reader_ = new protobuf::Reader();
+}
+
+ProtobufDecoder::ProtobufDecoder(const uint8_t* data, const uint32_t size)
+    : reader_(NULL), own_reader_(true) {
+    reader_ = new protobuf::Reader();
+    bool status = reader_->parse(data, size);
+    assert(status);
+}
+
+ProtobufDecoder::ProtobufDecoder(ProtobufDecoder& parent, const uint8_t* data,
+                                 const uint32_t size)
+    : reader_(NULL), own_reader_(false) {
+    reader_ = parent.reader_->getChild();
     bool status = reader_->parse(data, size);
     assert(status);
 }
 
 ProtobufDecoder::~ProtobufDecoder() {
-    if (reader_) {
+    if (reader_ && own_reader_) {
         delete reader_;
     }
 }
 
+bool ProtobufDecoder::reset(const uint8_t* data, const uint32_t size) {
+    return reader_->parse(data, size);
+}
+
 const char* ProtobufDecoder::getError() const {
     if (!reader_) {
         return "reader is null";
@@ -100,7 +117,13 @@ void ProtobufDecoder::readValue(const GenericNode& node, double& value,
 void ProtobufDecoder::readValue(const GenericNode& node, std::string& value,
                                 const protobuf::FieldType field_type) {
     assert(field_type == protobuf::FIELDTYPE_BYTES || field_type == protobuf::FIELDTYPE_STRING);
-    value.append((const char*)node.value, node.value_size);
+    value.assign((const char*)node.value, node.value_size);
+}
+
+void ProtobufDecoder::readValue(const GenericNode& node, StringRef& value,
+                                const protobuf::FieldType field_type) {
+    assert(field_type == protobuf::FIELDTYPE_BYTES || field_type == protobuf::FIELDTYPE_STRING);
+    value = StringRef((const char*)node.value, node.value_size);
 }
 
 const GenericNode* ProtobufDecoder::getNodeByNumber(const uint32_t field_number) const {
@@ -110,6 +133,11 @@ const GenericNode* ProtobufDecoder::getNodeByNumber(const uint32_t field_number)
     return reader_->getNodeByNumber(field_number);
 }
 
+const GenericNode* ProtobufDecoder::unpack(const GenericNode* node,
+                                          const protobuf::WireType wire_type) {
+    return reader_->unpack(node, wire_type);
+}
+
 protobuf::WireType ProtobufDecoder::getWireType(const GenericNode* node) {
     if (!node) {
         return protobuf::WIRETYPE_NONE;
@@ -2,6 +2,13 @@
 
 namespace serialflex {
 
+ProtobufEncoder::ProtobufEncoder(std::string& str)
+    : string_sink_(new StringSink(str)), sink_(*string_sink_) {}
+
+ProtobufEncoder::ProtobufEncoder(OutputSink& sink): string_sink_(NULL), sink_(sink) {}
+
+ProtobufEncoder::~ProtobufEncoder() { delete string_sink_; }
+
 void ProtobufEncoder::writeField(const Field<std::string>& field) {
     const std::string& str = field.getValue();
     if (str.empty()) {
@@ -12,6 +19,16 @@ void ProtobufEncoder::writeField(const Field<std::string>& field) {
     writeValue(str, field.getType());
 }
 
+void ProtobufEncoder::writeField(const Field<StringRef>& field) {
+    const StringRef& str = field.getValue();
+    if (str.empty()) {
+        return;
+    }
+    // tag - length - value
+    writeTag(field.getNumber(), field.getWireType());
+    writeValue(str, field.getType());
+}
+
 void ProtobufEncoder::writeValue(const int32_t& value, const protobuf::FieldType field_type) {
     if (field_type == protobuf::FIELDTYPE_INT32 || field_type == protobuf::FIELDTYPE_BOOL ||
         field_type == protobuf::FIELDTYPE_ENUM) {
@@ -27,7 +44,7 @@ void ProtobufEncoder::writeValue(const int32_t& value, const protobuf::FieldType
 
 void ProtobufEncoder::writeValue(const int64_t& value, const protobuf::FieldType field_type) {
     if (field_type == protobuf::FIELDTYPE_INT64) {
-        writeVarint((uint32_t)value);
+        writeVarint((uint64_t)value);
     } else if (field_type == protobuf::FIELDTYPE_SFIXED64) {
         writeFixed64(*reinterpret_cast<const uint64_t*>(&value));
     } else if (field_type == protobuf::FIELDTYPE_SINT64) {
@@ -82,7 +99,13 @@ void ProtobufEncoder::writeValue(const double& value, const protobuf::FieldType
 void ProtobufEncoder::writeValue(const std::string& value, const protobuf::FieldType field_type) {
     const uint64_t length = value.size();
     writeVarint(length);
-    str_.append(value.data(), length);
+    sink_.write(value.data(), length);
+}
+
+void ProtobufEncoder::writeValue(const StringRef& value, const protobuf::FieldType field_type) {
+    const uint64_t length = value.size();
+    writeVarint(length);
+    sink_.write(value.data(), length);
 }
 
 void ProtobufEncoder::writeTag(const uint32_t field_number, const protobuf::WireType wire_type) {
@@ -91,31 +114,44 @@ void ProtobufEncoder::writeTag(const uint32_t field_number, const protobuf::Wire
 }
 
 void ProtobufEncoder::writeVarint(const uint64_t value) {
+    // a 64-bit varint takes at most 10 bytes, the end of a fixed buffer may still hold this one
+    uint8_t buffer[10];
+    const bool direct = (sink_.room() >= sizeof(buffer));
+    uint8_t* const begin = direct ? (uint8_t*)sink_.cursor() : buffer;
+    uint8_t* ptr = begin;
     uint64_t v = value;
     while (v >= 0x80) {
-        const uint8_t c = static_cast<uint8_t>(v | 0x80);
-        str_.append(1, c);
+        *ptr++ = static_cast<uint8_t>(v | 0x80);
         v >>= 7;
     }
-    str_.append(1, static_cast<uint8_t>(v));
+    *ptr++ = static_cast<uint8_t>(v);
+    if (direct) {
+        sink_.advance(ptr - begin);
+    } else {
+        sink_.write((const char*)buffer, ptr - begin);
+    }
 }
 
 void ProtobufEncoder::writeFixed32(const uint32_t value) {
-    str_.append(1, (char)(value & 0xFF));
-    str_.append(1, (char)((value >> 8) & 0xFF));
-    str_.append(1, (char)((value >> 16) & 0xFF));
-    str_.append(1, (char)((value >> 24) & 0xFF));
+    if (!sink_.reserve(4)) {
+        return;
+    }
+    uint8_t* ptr = (uint8_t*)sink_.cursor();
+    for (int32_t idx = 0; idx < 4; ++idx) {
+        ptr[idx] = (uint8_t)((value >> (idx * 8)) & 0xFF);
+    }
+    sink_.advance(4);
 }
 
 void ProtobufEncoder::writeFixed64(const uint64_t value) {
-    str_.append(1, (char)(value & 0xFF));
-    str_.append(1, (char)((value >> 8) & 0xFF));
-    str_.append(1, (char)((value >> 16) & 0xFF));
-    str_.append(1, (char)((value >> 24) & 0xFF));
-    str_.append(1, (char)((value >> 32) & 0xFF));
-    str_.append(1, (char)((value >> 40) & 0xFF));
-    str_.append(1, (char)((value >> 48) & 0xFF));
-    str_.append(1, (char)((value >> 56) & 0xFF));
+    if (!sink_.reserve(8)) {
+        return;
+    }
+    uint8_t* ptr = (uint8_t*)sink_.cursor();
+    for (int32_t idx = 0; idx < 8; ++idx) {
+        ptr[idx] = (uint8_t)((value >> (idx * 8)) & 0xFF);
+    }
+    sink_.advance(8);
 }
 
 }// namespace serialflex
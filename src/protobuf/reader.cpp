@@ -5,62 +5,44 @@ namespace protobuf {
 
 class FieldWrapper {
     GenericNodeAllocator<GenericNode>& alloc_;
-    GenericNodeAllocator<GenericNode*>& alloc_numbers_;
+    std::vector<GenericNode*>& numbers_;
 
     GenericNode* last_node_;
-    uint32_t last_field_number_;
 
 public:
-    FieldWrapper(GenericNodeAllocator<GenericNode>& alloc,
-                 GenericNodeAllocator<GenericNode*>& alloc_numbers)
-        : alloc_(alloc), alloc_numbers_(alloc_numbers), last_node_(NULL), last_field_number_(0) {}
+    FieldWrapper(GenericNodeAllocator<GenericNode>& alloc, std::vector<GenericNode*>& numbers)
+        : alloc_(alloc), numbers_(numbers), last_node_(NULL) {}
 
     void addField(const uint32_t field_number, const WireType wire_type, const uint32_t value,
                   const uint8_t* data, const uint64_t size) {
         GenericNode* field = createField(field_number, (WireType)wire_type);
-        if (field) {
-            field->u32 = value;
-            field->value = (const char*)data;
-            field->value_size = (uint32_t)size;
+        field->u32 = value;
+        field->value = (const char*)data;
+        field->value_size = (uint32_t)size;
 
-            updateLastField(*field);
-        } else {
-            updateLastFieldNumber(field_number);
-        }
+        updateLastField(*field);
     }
     void addField(const uint32_t field_number, const WireType wire_type, const uint64_t value,
                   const uint8_t* data, const uint64_t size) {
         GenericNode* field = createField(field_number, (WireType)wire_type);
-        if (field) {
-            field->u64 = value;
-            field->value = (const char*)data;
-            field->value_size = (uint32_t)size;
+        field->u64 = value;
+        field->value = (const char*)data;
+        field->value_size = (uint32_t)size;
 
-            updateLastField(*field);
-        } else {
-            updateLastFieldNumber(field_number);
-        }
+        updateLastField(*field);
     }
     void addField(const uint32_t field_number, const WireType wire_type, const uint8_t* data,
                   const uint64_t size) {
         GenericNode* field = createField(field_number, (WireType)wire_type);
-        if (field) {
-            field->value = (const char*)data;
-            field->value_size = (uint32_t)size;
+        field->value = (const char*)data;
+        field->value_size = (uint32_t)size;
 
-            updateLastField(*field);
-        } else {
-            updateLastFieldNumber(field_number);
-        }
+        updateLastField(*field);
     }
 
 private:
     GenericNode* createField(const uint32_t number, const WireType type) {
         GenericNode* new_field = alloc_.allocValue();
-        if (!new_field) {
-            ++alloc_;
-            return NULL;
-        }
         new_field->number = number;
         new_field->type = type;
         return new_field;
@@ -69,38 +51,20 @@ private:
         if (last_node_ && last_node_->number == field.number) {
             last_node_->next = &field;
         } else {
-            GenericNode** number_field = alloc_numbers_.allocValue();
-            assert(number_field);
-            if (number_field) {
-                *number_field = &field;
-            }
+            numbers_.push_back(&field);
         }
         last_node_ = &field;
     }
-
-    void updateLastFieldNumber(const uint32_t field_number) {
-        if (last_field_number_ != 0 && last_field_number_ == field_number) {
-            ;
-        } else {
-            ++alloc_numbers_;
-        }
-        last_field_number_ = field_number;
-    }
 };
 
 /*--------------------------------------------------------------------------------*/
 
 bool Reader::parse(const uint8_t* bytes, const uint32_t size) {
-    const uint8_t* binary_bytes = bytes;
-    do {
-        ++alloc_;
-        parseFromBytes(bytes, size);
-    } while (false);
-
-    alloc_.reSize();
-    alloc_numbers_.reSize();
+    alloc_.clear();
+    numbers_.clear();
+    str_error_.clear();
 
-    if (!parseFromBytes(binary_bytes, size)) {
+    if (!parseFromBytes(bytes, size)) {
         return false;
     }
     if (!str_error_.empty()) {
@@ -128,10 +92,69 @@ const GenericNode* Reader::getNodeByNumber(const uint32_t field_number) const {
     return NULL;
 }
 
+const GenericNode* Reader::unpack(const GenericNode* node, const WireType wire_type) {
+    const GenericNode* cur = node;
+    for (; cur && cur->type != WIRETYPE_LENGTH_DELIMITED; cur = cur->next) {
+    }
+    if (!cur) {
+        return node;
+    }
+
+    GenericNode* first = NULL;
+    GenericNode* last = NULL;
+    for (cur = node; cur; cur = cur->next) {
+        const uint8_t* current = (const uint8_t*)cur->value;
+        uint32_t remaining = (cur->type == WIRETYPE_LENGTH_DELIMITED) ? cur->value_size : 0;
+        if (!remaining) {
+            // an element written unpacked, or an empty payload with no element at all
+            if (cur->type == WIRETYPE_LENGTH_DELIMITED) {
+                continue;
+            }
+            GenericNode* item = alloc_.allocValue();
+            *item = *cur;
+            item->next = NULL;
+            if (last) {
+                last->next = item;
+            } else {
+                first = item;
+            }
+            last = item;
+            continue;
+        }
+        while (remaining > 0) {
+            const uint8_t* data = current;
+            const uint32_t pos = remaining;
+            GenericNode* item = alloc_.allocValue();
+            item->number = cur->number;
+            item->type = wire_type;
+            item->next = NULL;
+            if (wire_type == WIRETYPE_VARINT) {
+                item->u64 = readVarInt(current, remaining);
+            } else if (wire_type == WIRETYPE_FIXED64) {
+                item->u64 = readFromBytes<uint64_t>(current, remaining);
+            } else {
+                item->u64 = readFromBytes<uint32_t>(current, remaining);
+            }
+            if (!str_error_.empty()) {
+                return node;
+            }
+            item->value = (const char*)data;
+            item->value_size = pos - remaining;
+            if (last) {
+                last->next = item;
+            } else {
+                first = item;
+            }
+            last = item;
+        }
+    }
+    return first;
+}
+
 bool Reader::parseFromBytes(const uint8_t* bytes, const uint32_t size) {
     const uint8_t* current = bytes;
     uint32_t remaining = size;
-    FieldWrapper wrapper(alloc_, alloc_numbers_);
+    FieldWrapper wrapper(alloc_, numbers_);
     for (; remaining > 0;) {
         uint8_t wire_type = WIRETYPE_NONE;
         uint32_t field_number = 0;
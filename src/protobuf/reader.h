@@ -4,6 +4,7 @@
 #include <serialflex/field.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 #include <string>
 #include <vector>
 #include "node.h"
@@ -12,21 +13,29 @@ namespace serialflex {
 namespace protobuf {
 
 class Reader {
-    std::vector<GenericNode> nodes_;
     GenericNodeAllocator<GenericNode> alloc_;
     std::vector<GenericNode*> numbers_;// protobuf use
-    GenericNodeAllocator<GenericNode*> alloc_numbers_;
     std::string str_error_;
+    Reader* child_;// reused by nested messages
 
     Reader(const Reader&);
     Reader& operator==(const Reader&);
 
 public:
-    Reader(): alloc_(nodes_), alloc_numbers_(numbers_) {}
-    ~Reader() {}
+    Reader(): child_(NULL) {}
+    ~Reader() { delete child_; }
     bool parse(const uint8_t* bytes, const uint32_t size);
     const char* getError() const;
     const GenericNode* getNodeByNumber(const uint32_t field_number) const;
+    // packed payloads in the chain of node become one node of wire_type per element, node
+    // itself is returned when nothing is packed
+    const GenericNode* unpack(const GenericNode* node, const WireType wire_type);
+    Reader* getChild() {
+        if (!child_) {
+            child_ = new Reader();
+        }
+        return child_;
+    }
 
 private:
     void setError(const char* error) { str_error_ = error; }
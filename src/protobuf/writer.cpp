@@ -12,6 +12,14 @@ MessageByteSize& MessageByteSize::operator&(const Field<std::string>& field) {
     return *this;
 }
 
+MessageByteSize& MessageByteSize::operator&(const Field<StringRef>& field) {
+    if (field.getHas() && field.getNumber() != 0 && !field.getValue().empty()) {
+        // tag - length - value
+        fieldSize(field);
+    }
+    return *this;
+}
+
 uint32_t MessageByteSize::valueSize(const int32_t& value, const FieldType field_type) {
     if (field_type == FIELDTYPE_INT32 || field_type == FIELDTYPE_BOOL ||
         field_type == FIELDTYPE_ENUM) {
@@ -76,6 +84,11 @@ uint32_t MessageByteSize::valueSize(const std::string& value, const FieldType fi
     return (uint32_t)value.size();
 }
 
+uint32_t MessageByteSize::valueSize(const StringRef& value, const FieldType field_type) {
+    assert(field_type == FIELDTYPE_STRING || field_type == FIELDTYPE_BYTES);
+    return (uint32_t)value.size();
+}
+
 uint32_t MessageByteSize::varintSize(const uint64_t value) {
     if (value < (1ull << 35)) {
         if (value < (1ull << 7)) {
@@ -0,0 +1,67 @@
+#ifndef __SCRATCH_H__
+#define __SCRATCH_H__
+
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+
+namespace serialflex {
+
+// Decoded text that has no verbatim copy in the input, for StringRef fields. Blocks never move
+// once handed out, clear() keeps them for the next document.
+class Scratch {
+    enum { kBlockSize = 4096 };
+    struct Block {
+        char* data;
+        size_t capacity;
+    };
+
+    std::vector<Block> blocks_;
+    size_t cur_block_;
+    size_t used_;// bytes taken from the current block
+
+    Scratch(const Scratch&);
+    Scratch& operator=(const Scratch&);
+
+public:
+    Scratch(): cur_block_(0), used_(0) {}
+    ~Scratch() {
+        for (size_t idx = 0; idx < blocks_.size(); ++idx) {
+            delete[] blocks_[idx].data;
+        }
+    }
+    void clear() {
+        cur_block_ = 0;
+        used_ = 0;
+    }
+    // a copy of data that lives until clear()
+    const char* store(const char* data, size_t size) {
+        char* copy = alloc(size);
+        if (size) {
+            memcpy(copy, data, size);
+        }
+        return copy;
+    }
+
+private:
+    char* alloc(size_t size) {
+        for (; cur_block_ < blocks_.size(); ++cur_block_, used_ = 0) {
+            const Block& block = blocks_[cur_block_];
+            if (block.capacity - used_ >= size) {
+                char* result = block.data + used_;
+                used_ += size;
+                return result;
+            }
+        }
+        // oversized values get a block of their own
+        const Block block = {NULL, size > kBlockSize ? size : (size_t)kBlockSize};
+        blocks_.push_back(block);
+        blocks_.back().data = new char[block.capacity];
+        used_ = size;
+        return blocks_.back().data;
+    }
+};
+
+}// namespace serialflex
+
+#endif
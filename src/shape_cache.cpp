@@ -0,0 +1,57 @@
+#include "shape_cache.h"
+
+namespace serialflex {
+
+uint32_t ShapeCache::shapeOf(const void* type) {
+    if (!types_.empty()) {
+        std::map<const void*, uint32_t>::const_iterator it = types_.find(type);
+        if (it != types_.end()) {
+            return it->second;
+        }
+    }
+    // type addresses may lie a byte apart, all their bits go into the slot
+    const uint64_t hash = (uint64_t)(uintptr_t)type * 0x9E3779B97F4A7C15ULL;
+    const void*& seen = seen_[(hash >> 32) % SEEN_SLOTS];
+    if (seen != type) {
+        seen = type;
+        return NO_SHAPE;
+    }
+    const uint32_t shape = (uint32_t)shapes_.size();
+    shapes_.push_back(std::vector<uint8_t>());
+    types_.insert(std::pair<const void*, uint32_t>(type, shape));
+    return shape;
+}
+
+void ShapeCache::enter(const void* type, const TapeNode* object) {
+    const Frame frame = {shapeOf(type), 0, object, NULL};
+    frames_.push_back(frame);
+}
+
+void ShapeCache::bind(const TapeNode* object, const TapeNode* child) {
+    if (frames_.empty() || frames_.back().object != object || frames_.back().shape == NO_SHAPE) {
+        return;
+    }
+    Frame& frame = frames_.back();
+    std::vector<uint8_t>& shape = shapes_[frame.shape];
+    if (shape.empty()) {
+        shape.reserve(RESERVED_FIELDS);
+    }
+    if (frame.field >= shape.size()) {
+        shape.resize(frame.field + 1, 0);
+    }
+    uint8_t steps = 0;
+    if (child) {
+        // only short hops forward are worth predicting
+        const TapeNode* node = advance(object, frame.last, 1);
+        for (uint32_t idx = 1; node && idx <= MAX_STEPS; ++idx, node = node->next()) {
+            if (node == child) {
+                steps = (uint8_t)idx;
+                break;
+            }
+        }
+        frame.last = child;
+    }
+    shape[frame.field++] = steps;
+}
+
+}// namespace serialflex
@@ -0,0 +1,93 @@
+#ifndef __SHAPE_CACHE_H__
+#define __SHAPE_CACHE_H__
+
+#include <stdint.h>
+#include <string.h>
+#include <map>
+#include <vector>
+#include <serialflex/small_vector.h>
+#include "tape.h"
+
+namespace serialflex {
+
+// Field order of the message types a decoder has seen. Messages of one type usually list their
+// keys in the order of the convert calls, so each field remembers how many siblings past the
+// previously bound one it was found last time, and the lookup tests that node first. A miss
+// falls back to the search and updates the shape; an object that repeats a key may then bind
+// the occurrence at the predicted position rather than the first. The shapes outlive the tape,
+// the frames of the objects being decoded do not.
+// A type gets a shape only the second time it is entered, so a decoder that reads a single
+// message of each type allocates nothing here.
+class ShapeCache {
+    enum { NO_SHAPE = 0xffffffff, SEEN_SLOTS = 16, INLINE_FRAMES = 8, RESERVED_FIELDS = 16 };
+
+    struct Frame {
+        uint32_t shape;        // NO_SHAPE while the type has been entered once
+        uint32_t field;        // convert calls made in the object so far
+        const TapeNode* object;
+        const TapeNode* last;  // child bound last, NULL before the first
+    };
+
+    std::map<const void*, uint32_t> types_;
+    // per shape and field: siblings from the previously bound child, 0 when unknown
+    std::vector<std::vector<uint8_t> > shapes_;
+    SmallVector<Frame, INLINE_FRAMES> frames_;
+    // types entered once, by address; a collision only delays the shape of a type
+    const void* seen_[SEEN_SLOTS];
+
+    ShapeCache(const ShapeCache&);
+    ShapeCache& operator=(const ShapeCache&);
+
+public:
+    enum { MAX_STEPS = 4 };
+
+    ShapeCache() { memset(seen_, 0, sizeof(seen_)); }
+
+    // type is a per-type address, object the node the fields of that type are read from
+    void enter(const void* type, const TapeNode* object);
+    void leave() { frames_.pop_back(); }
+
+    // node predicted for the next field read from object, NULL when there is none
+    const TapeNode* predict(const TapeNode* object) const {
+        if (frames_.empty() || frames_.back().object != object) {
+            return NULL;
+        }
+        const Frame& frame = frames_.back();
+        if (frame.shape == NO_SHAPE) {
+            return NULL;
+        }
+        const std::vector<uint8_t>& shape = shapes_[frame.shape];
+        if (frame.field >= shape.size() || !shape[frame.field]) {
+            return NULL;
+        }
+        return advance(object, frame.last, shape[frame.field]);
+    }
+    // the predicted node was the field
+    void hit(const TapeNode* child) {
+        Frame& frame = frames_.back();
+        frame.last = child;
+        ++frame.field;
+    }
+    // the next field read from object was bound to child, NULL when it is missing
+    void bind(const TapeNode* object, const TapeNode* child);
+
+private:
+    uint32_t shapeOf(const void* type);
+    // sibling steps after last, counting the first child as one step when last is NULL
+    static const TapeNode* advance(const TapeNode* object, const TapeNode* last,
+                                   uint32_t steps) {
+        const TapeNode* node = last;
+        if (!node) {
+            node = object->child();
+            --steps;
+        }
+        for (; node && steps; --steps) {
+            node = node->next();
+        }
+        return node;
+    }
+};
+
+}// namespace serialflex
+
+#endif
@@ -0,0 +1,37 @@
+#include "simd.h"
+
+namespace serialflex {
+
+namespace simd {
+
+static bool detectAVX2() {
+#if defined(SERIALFLEX_AVX2) && defined(__GNUC__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#elif defined(SERIALFLEX_AVX2) && defined(_MSC_VER)
+    int info[4] = {0};
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return false;
+#endif
+}
+
+bool hasAVX2() {
+    static const bool avx2 = detectAVX2();
+    return avx2;
+}
+
+}// namespace simd
+
+}// namespace serialflex
@@ -0,0 +1,72 @@
+#ifndef __SIMD_H__
+#define __SIMD_H__
+
+#include <stdint.h>
+
+// SSE2 is part of the x86-64 baseline, AVX2 is compiled per function and picked at run time.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SERIALFLEX_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || __GNUC__ >= 5)
+#define SERIALFLEX_AVX2 1
+#define SERIALFLEX_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define SERIALFLEX_AVX2 1
+#define SERIALFLEX_TARGET_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace serialflex {
+
+namespace simd {
+
+// cpu supports (and the os saves) the avx2 registers
+bool hasAVX2();
+
+// index of the lowest set bit, value must not be zero
+inline uint32_t trailingZeros(uint64_t value) {
+#if defined(__GNUC__)
+    return (uint32_t)__builtin_ctzll(value);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index = 0;
+    _BitScanForward64(&index, value);
+    return (uint32_t)index;
+#else
+    uint32_t index = 0;
+    for (; !(value & 1); value >>= 1) {
+        ++index;
+    }
+    return index;
+#endif
+}
+
+// number of zero bits above the highest set bit, value must not be zero
+inline uint32_t leadingZeros(uint64_t value) {
+#if defined(__GNUC__)
+    return (uint32_t)__builtin_clzll(value);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index = 0;
+    _BitScanReverse64(&index, value);
+    return 63 - (uint32_t)index;
+#else
+    uint32_t count = 0;
+    for (; !(value & 0x8000000000000000ULL); value <<= 1) {
+        ++count;
+    }
+    return count;
+#endif
+}
+
+}// namespace simd
+
+}// namespace serialflex
+
+#endif
@@ -0,0 +1,168 @@
+#include <errno.h>
+#include <serialflex/sink.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace serialflex {
+
+void OutputSink::write(const char* data, size_t size) {
+    while (size) {
+        if (cursor_ == end_ && (failed_ || !makeRoom(size) || cursor_ == end_)) {
+            failed_ = true;
+            return;
+        }
+        size_t count = (size_t)(end_ - cursor_);
+        if (count > size) {
+            count = size;
+        }
+        memcpy(cursor_, data, count);
+        cursor_ += count;
+        data += count;
+        size -= count;
+    }
+}
+
+/*------------------------------------------------------------------------------*/
+
+StringSink::StringSink(std::string& str): str_(str), start_(0), written_(0) {}
+
+StringSink::~StringSink() { flush(); }
+
+size_t StringSink::size() const {
+    if (!cursor_) {
+        return written_;
+    }
+    return written_ + (size_t)(cursor_ - (&str_[0] + start_));
+}
+
+void StringSink::expect(size_t size) {
+    if ((size_t)(end_ - cursor_) < size) {
+        // reserved to fit, makeRoom alone would double the capacity
+        flush();
+        str_.reserve(str_.size() + size);
+        makeRoom(size);
+    }
+}
+
+bool StringSink::flush() {
+    if (cursor_) {
+        const size_t used = (size_t)(cursor_ - &str_[0]);
+        written_ += used - start_;
+        str_.resize(used);
+        cursor_ = NULL;
+        end_ = NULL;
+    }
+    return !failed_;
+}
+
+bool StringSink::makeRoom(size_t size) {
+    // the window opens at the end of the string and spans its whole capacity
+    size_t used = str_.size();
+    if (cursor_) {
+        used = (size_t)(cursor_ - &str_[0]);
+    } else {
+        start_ = used;
+    }
+    const size_t capacity = str_.capacity();
+    if (used + size > capacity) {
+        str_.reserve((used + size > capacity * 2) ? used + size : capacity * 2);
+    }
+    str_.resize(str_.capacity());
+    cursor_ = &str_[0] + used;
+    end_ = &str_[0] + str_.size();
+    return true;
+}
+
+/*------------------------------------------------------------------------------*/
+
+BufferSink::BufferSink(char* buffer, size_t capacity): buffer_(buffer) {
+    cursor_ = buffer;
+    end_ = buffer + capacity;
+}
+
+bool BufferSink::makeRoom(size_t size) {
+    (void)size;
+    return false;
+}
+
+/*------------------------------------------------------------------------------*/
+
+CountingSink::CountingSink(): counted_(0) {
+    cursor_ = window_;
+    end_ = window_ + WINDOW_SIZE;
+}
+
+bool CountingSink::makeRoom(size_t size) {
+    (void)size;
+    counted_ += (size_t)(cursor_ - window_);
+    cursor_ = window_;
+    return true;
+}
+
+/*------------------------------------------------------------------------------*/
+
+ChunkSink::ChunkSink(): drained_(0) {
+    cursor_ = chunk_;
+    end_ = chunk_ + CHUNK_SIZE;
+}
+
+bool ChunkSink::flush() {
+    if (!failed_ && !makeRoom(0)) {
+        failed_ = true;
+    }
+    return !failed_;
+}
+
+bool ChunkSink::makeRoom(size_t size) {
+    (void)size;
+    const size_t length = (size_t)(cursor_ - chunk_);
+    if (length && !drain(chunk_, length)) {
+        return false;
+    }
+    drained_ += length;
+    cursor_ = chunk_;
+    end_ = chunk_ + CHUNK_SIZE;
+    return true;
+}
+
+FileSink::~FileSink() { flush(); }
+
+bool FileSink::flush() {
+    if (!ChunkSink::flush()) {
+        return false;
+    }
+    if (fflush(file_) != 0) {
+        failed_ = true;
+    }
+    return !failed_;
+}
+
+bool FileSink::drain(const char* data, size_t size) {
+    return fwrite(data, 1, size, file_) == size;
+}
+
+FdSink::~FdSink() { flush(); }
+
+bool FdSink::drain(const char* data, size_t size) {
+    while (size) {
+#ifdef _WIN32
+        const int result = _write(fd_, data, (unsigned int)size);
+#else
+        const ssize_t result = ::write(fd_, data, size);
+#endif
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += result;
+        size -= (size_t)result;
+    }
+    return true;
+}
+
+}// namespace serialflex
@@ -0,0 +1,39 @@
+#include <serialflex/table.h>
+
+namespace serialflex {
+
+namespace internal {
+
+void runTable(void* archive, uint32_t archive_id, const MessageTable& table, void* object) {
+    char* start = (char*)object;
+    for (size_t idx = 0, size = table.size(); idx < size; ++idx) {
+        const TableField& field = table[idx];
+        const TableOp op = field.codec->ops[archive_id];
+        if (op) {
+            bool* has_value =
+                (field.has_value == (size_t)NO_HAS_VALUE) ? NULL : (bool*)(start + field.has_value);
+            op(archive, field, start + field.value, has_value);
+        }
+    }
+}
+
+void TableRecorder::add(const char* name, uint32_t number, protobuf::FieldType type,
+                        protobuf::FieldType type2, bool packed, const void* value,
+                        const bool* has_value, const TableCodec* codec) {
+    const TableField field = {name,   number,        type,
+                              type2,  packed,        offset(value),
+                              has_value ? offset(has_value) : (size_t)NO_HAS_VALUE,
+                              codec};
+    table_.add(field);
+}
+
+size_t TableRecorder::offset(const void* member) const {
+    const char* address = (const char*)member;
+    // a member of the object, anything else would be the sample's own
+    assert(object_ <= address && address < object_ + size_);
+    return (size_t)(address - object_);
+}
+
+}// namespace internal
+
+}// namespace serialflex
@@ -0,0 +1,92 @@
+#ifndef __TAPE_H__
+#define __TAPE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace serialflex {
+
+// Document node of the text readers: 16 bytes of offsets into the source instead of a linked
+// GenericNode. Nodes are stored in document order, so the first child of a container follows
+// it directly and its next sibling comes after the whole subtree.
+struct TapeNode {
+    enum {
+        KEY_SIZE_MAX = 0x00FFFFFF,
+        TYPE_MASK = 0x3F,
+        FLAG_CONTAINER = 0x40,// value holds the subtree size, value_size the child count
+        FLAG_LAST = 0x80      // no next sibling
+    };
+
+    uint32_t key;       // offset of the key
+    uint32_t meta;      // key length in the low 24 bits, type and flags in the high 8
+    uint32_t value;     // offset of the value, or the subtree size of a container
+    uint32_t value_size;// length of the value, or the child count of a container
+
+    int32_t type() const { return (int32_t)((meta >> 24) & TYPE_MASK); }
+    uint32_t keySize() const { return meta & KEY_SIZE_MAX; }
+    bool isContainer() const { return ((meta >> 24) & FLAG_CONTAINER) != 0; }
+    bool isLast() const { return ((meta >> 24) & FLAG_LAST) != 0; }
+
+    const TapeNode* child() const { return (isContainer() && value_size) ? this + 1 : NULL; }
+    const TapeNode* next() const {
+        if (isLast()) {
+            return NULL;
+        }
+        return this + (isContainer() ? value : 1);
+    }
+    uint32_t childCount() const { return isContainer() ? value_size : 0; }
+};
+
+// Grows the tape while a reader walks the document. Nodes are addressed by index during the
+// parse because appending may move the storage; clear() keeps the capacity for the next one.
+class Tape {
+    std::vector<TapeNode> nodes_;
+
+    Tape(const Tape&);
+    Tape& operator=(const Tape&);
+
+public:
+    Tape() {}
+
+    void clear() { nodes_.clear(); }
+    uint32_t size() const { return (uint32_t)nodes_.size(); }
+    const TapeNode* root() const { return nodes_.empty() ? NULL : &nodes_[0]; }
+    TapeNode& at(const uint32_t index) { return nodes_[index]; }
+
+    uint32_t append(const int32_t type) {
+        TapeNode node = {0, (uint32_t)type << 24, 0, 0};
+        nodes_.push_back(node);
+        return (uint32_t)nodes_.size() - 1;
+    }
+    void setType(const uint32_t index, const int32_t type) {
+        TapeNode& node = nodes_[index];
+        node.meta = (node.meta & ~((uint32_t)TapeNode::TYPE_MASK << 24)) | ((uint32_t)type << 24);
+    }
+    void setKey(const uint32_t index, const uint32_t key, const uint32_t key_size) {
+        TapeNode& node = nodes_[index];
+        node.key = key;
+        node.meta = (node.meta & ~(uint32_t)TapeNode::KEY_SIZE_MAX) | key_size;
+    }
+    void setValue(const uint32_t index, const uint32_t value, const uint32_t value_size) {
+        nodes_[index].value = value;
+        nodes_[index].value_size = value_size;
+    }
+    void setLast(const uint32_t index) {
+        nodes_[index].meta |= (uint32_t)TapeNode::FLAG_LAST << 24;
+    }
+    // the subtree of index ends at the current end of the tape
+    void closeContainer(const uint32_t index, const uint32_t children, const uint32_t last_child) {
+        TapeNode& node = nodes_[index];
+        node.meta |= (uint32_t)TapeNode::FLAG_CONTAINER << 24;
+        node.value = size() - index;
+        node.value_size = children;
+        if (children) {
+            setLast(last_child);
+        }
+    }
+};
+
+}// namespace serialflex
+
+#endif
@@ -3,13 +3,25 @@
 
 namespace serialflex {
 
+XMLDecoder::XMLDecoder()
+    : convert_by_type_(true), case_insensitive_(false), padded_(false), current_(NULL) {
+    reader_ = new xml::Reader();
+}
+
 XMLDecoder::XMLDecoder(const char* str, bool case_insensitive)
-    : convert_by_type_(true), case_insensitive_(case_insensitive), current_(NULL) {
+    : convert_by_type_(true), case_insensitive_(case_insensitive), padded_(false), current_(NULL) {
     reader_ = new xml::Reader();
     current_ = reader_->parse(str);
     assert(current_);
 }
 
+XMLDecoder::XMLDecoder(const char* data, size_t len, bool case_insensitive)
+    : convert_by_type_(true), case_insensitive_(case_insensitive), padded_(false), current_(NULL) {
+    reader_ = new xml::Reader();
+    current_ = reader_->parse(data, len, padded_);
+    assert(current_);
+}
+
 XMLDecoder::~XMLDecoder() {
     if (reader_) {
         delete reader_;
@@ -23,13 +35,33 @@ const char* XMLDecoder::getError() const {
     return reader_->getError();
 }
 
+bool XMLDecoder::reset(const char* str) {
+    current_ = reader_->parse(str);
+    return current_ != NULL;
+}
+
+bool XMLDecoder::reset(const char* data, size_t len) {
+    current_ = reader_->parse(data, len, padded_);
+    return current_ != NULL;
+}
+
+XMLDecoder& XMLDecoder::setPadded(bool padded) {
+    padded_ = padded;
+    return *this;
+}
+
+XMLDecoder& XMLDecoder::setCaseInsensitive(bool case_insensitive) {
+    case_insensitive_ = case_insensitive;
+    return *this;
+}
+
 XMLDecoder& XMLDecoder::setConvertByType(bool convert_by_type) {
     convert_by_type_ = convert_by_type;
     return *this;
 }
 
 void XMLDecoder::decodeValue(const char* name, bool& value, bool* has_value) {
-    const GenericNode* item = XMLDecoder::getObjectItem(current_, name, case_insensitive_);
+    const TapeNode* item = XMLDecoder::getObjectItem(current_, name, case_insensitive_);
     if (item) {
         value = item2Bool(*item);
         if (has_value) {
@@ -39,9 +71,14 @@ void XMLDecoder::decodeValue(const char* name, bool& value, bool* has_value) {
 }
 
 void XMLDecoder::decodeValue(const char* name, uint32_t& value, bool* has_value) {
-    const GenericNode* item = XMLDecoder::getObjectItem(current_, name, case_insensitive_);
+    const TapeNode* item = XMLDecoder::getObjectItem(current_, name, case_insensitive_);
     if (item) {
-        value = (uint32_t)xml::Reader::convertUint(item->value, item->value_size);
+        uint32_t size = 0;
+        const char* text = getText(*item, size);
+        if (!xml::Reader::convertUint(text, size, value)) {
+            reader_->setError("invalid number");
+            return;
+        }
         if (has_value) {
             *has_value = true;
         }
@@ -49,9 +86,14 @@ void XMLDecoder::decodeValue(const char* name, uint32_t& value, bool* has_value)
 }
 
 void XMLDecoder::decodeValue(const char* name, int32_t& value, bool* has_value) {
-    const GenericNode* item = XMLDecoder::getObjectItem(current_, name, case_insensitive_);
+    const TapeNode* item = XMLDecoder::getObjectItem(current_, name, case_insensitive_);
     if (item) {
-        value = (int32_t)xml::Reader::convertInt(item->value, item->value_size);
+        uint32_t size = 0;
+        const char* text = getText(*item, size);
+        if (!xml::Reader::convertInt(text, size, value)) {
+            reader_->setError("invalid number");
+            return;
+        }
         if (has_value) {
             *has_value = true;
         }
@@ -59,9 +101,14 @@ void XMLDecoder::decodeValue(const char* name, int32_t& value, bool* has_value)
 }
 
 void XMLDecoder::decodeValue(const char* name, uint64_t& value, bool* has_value) {
-    const GenericNode* item = XMLDecoder::getObjectItem(current_, name, case_insensitive_);
+    const TapeNode* item = XMLDecoder::getObjectItem(current_, name, case_insensitive_);
     if (item) {
-        value = xml::Reader::convertUint(item->value, item->value_size);
+        uint32_t size = 0;
+        const char* text = getText(*item, size);
+        if (!xml::Reader::convertUint(text, size, value)) {
+            reader_->setError("invalid number");
+            return;
+        }
         if (has_value) {
             *has_value = true;
         }
@@ -69,9 +116,14 @@ void XMLDecoder::decodeValue(const char* name, uint64_t& value, bool* has_value)
 }
 
 void XMLDecoder::decodeValue(const char* name, int64_t& value, bool* has_value) {
-    const GenericNode* item = XMLDecoder::getObjectItem(current_, name, case_insensitive_);
+    const TapeNode* item = XMLDecoder::getObjectItem(current_, name, case_insensitive_);
     if (item) {
-        value = xml::Reader::convertInt(item->value, item->value_size);
+        uint32_t size = 0;
+        const char* text = getText(*item, size);
+        if (!xml::Reader::convertInt(text, size, value)) {
+            reader_->setError("invalid number");
+            return;
+        }
         if (has_value) {
             *has_value = true;
         }
@@ -79,9 +131,14 @@ void XMLDecoder::decodeValue(const char* name, int64_t& value, bool* has_value)
 }
 
 void XMLDecoder::decodeValue(const char* name, float& value, bool* has_value) {
-    const GenericNode* item = XMLDecoder::getObjectItem(current_, name, case_insensitive_);
+    const TapeNode* item = XMLDecoder::getObjectItem(current_, name, case_insensitive_);
     if (item) {
-        value = (float)xml::Reader::convertDouble(item->value, item->value_size);
+        uint32_t size = 0;
+        const char* text = getText(*item, size);
+        if (!xml::Reader::convertFloat(text, size, value)) {
+            reader_->setError("invalid number");
+            return;
+        }
         if (has_value) {
             *has_value = true;
         }
@@ -89,9 +146,14 @@ void XMLDecoder::decodeValue(const char* name, float& value, bool* has_value) {
 }
 
 void XMLDecoder::decodeValue(const char* name, double& value, bool* has_value) {
-    const GenericNode* item = XMLDecoder::getObjectItem(current_, name, case_insensitive_);
+    const TapeNode* item = XMLDecoder::getObjectItem(current_, name, case_insensitive_);
     if (item) {
-        value = xml::Reader::convertDouble(item->value, item->value_size);
+        uint32_t size = 0;
+        const char* text = getText(*item, size);
+        if (!xml::Reader::convertDouble(text, size, value)) {
+            reader_->setError("invalid number");
+            return;
+        }
         if (has_value) {
             *has_value = true;
         }
@@ -99,30 +161,53 @@ void XMLDecoder::decodeValue(const char* name, double& value, bool* has_value) {
 }
 
 void XMLDecoder::decodeValue(const char* name, std::string& value, bool* has_value) {
-    const GenericNode* item = XMLDecoder::getObjectItem(current_, name, case_insensitive_);
+    const TapeNode* item = XMLDecoder::getObjectItem(current_, name, case_insensitive_);
     if (!item) {
         return;
     }
-    if (item->value && item->value_size) {
+    uint32_t size = 0;
+    const char* text = getText(*item, size);
+    if (size || item->isContainer()) {
         value.clear();
-        value.append(item->value, item->value_size);
+        value.append(text, size);
         if (has_value) {
             *has_value = true;
         }
-        XMLDecoder::dealWithString(value);
-    } else if (const GenericNode* data = item->child) {
-        value.clear();
-        value.append(data->value, data->value_size);
+        // cdata is kept verbatim
+        const TapeNode* data = item->child();
+        if (!data || data->type() != xml::NODE_CDATA) {
+            XMLDecoder::dealWithString(value);
+        }
+    }
+}
+
+void XMLDecoder::decodeValue(const char* name, StringRef& value, bool* has_value) {
+    const TapeNode* item = XMLDecoder::getObjectItem(current_, name, case_insensitive_);
+    if (!item) {
+        return;
+    }
+    uint32_t size = 0;
+    const char* text = getText(*item, size);
+    if (size || item->isContainer()) {
         if (has_value) {
             *has_value = true;
         }
+        // cdata and text without entities are used in place
+        const TapeNode* data = item->child();
+        if ((data && data->type() == xml::NODE_CDATA) || !size || !memchr(text, '&', size)) {
+            value = StringRef(text, size);
+            return;
+        }
+        std::string str(text, size);
+        XMLDecoder::dealWithString(str);
+        value = StringRef(reader_->getScratch().store(str.data(), str.size()), str.size());
     }
 }
 
 void XMLDecoder::decodeValue(const char* name, std::vector<bool>& value, bool* has_value) {
-    const GenericNode* item = XMLDecoder::getObjectItem(current_, name, case_insensitive_);
+    const TapeNode* item = XMLDecoder::getObjectItem(current_, name, case_insensitive_);
     if (item) {
-        for (const GenericNode* child = item->child; child; child = child->next) {
+        for (const TapeNode* child = item->child(); child; child = child->next()) {
             value.push_back(item2Bool(*child));
             if (has_value) {
                 *has_value = true;
@@ -131,69 +216,92 @@ void XMLDecoder::decodeValue(const char* name, std::vector<bool>& value, bool* h
     }
 }
 
-bool XMLDecoder::item2Bool(const GenericNode& item) const {
-    if (item.type == xml::NODE_ELEMENT) {
-        if (item.value_size == 5 && strncmp("false", item.value, item.value_size) == 0) {
+bool XMLDecoder::item2Bool(const TapeNode& item) const {
+    if (item.type() == xml::NODE_ELEMENT) {
+        uint32_t size = 0;
+        const char* text = getText(item, size);
+        if (size == 5 && strncmp("false", text, size) == 0) {
             return false;
-        } else if (item.value_size == 4 && strncmp("true", item.value, item.value_size) == 0) {
+        } else if (size == 4 && strncmp("true", text, size) == 0) {
             return true;
         }
-        return (atoi(std::string(item.value, item.value_size).c_str()));
+        return (atoi(std::string(text, size).c_str()));
     }
     return false;
 }
 
-uint32_t XMLDecoder::getObjectSize(const GenericNode* parent) {
-    uint32_t size = 0;
-    if (parent) {
-        for (const GenericNode* child = parent->child; child; child = child->next) {
-            ++size;
-        }
+const char* XMLDecoder::getText(const TapeNode& item, uint32_t& size) const {
+    const char* src = reader_->getSource();
+    if (!item.isContainer()) {
+        size = item.value_size;
+        return src + item.value;
+    }
+    const TapeNode* data = item.child();
+    if (data && (data->type() == xml::NODE_DATA || data->type() == xml::NODE_CDATA)) {
+        size = data->value_size;
+        return src + data->value;
     }
-    return size;
+    size = 0;
+    return src;
 }
 
-static int32_t strcasecmp(const char* s1, const char* s2) {
-    if (!s1) return (s1 == s2) ? 0 : 1;
-    if (!s2) return 1;
-    for (; tolower(*s1) == tolower(*s2); ++s1, ++s2)
-        if (*s1 == 0) return 0;
-    return tolower(*(const unsigned char*)s1) - tolower(*(const unsigned char*)s2);
+uint32_t XMLDecoder::getObjectSize(const TapeNode* parent) {
+    if (parent) {
+        return parent->childCount();
+    }
+    return 0;
 }
 
-const GenericNode* XMLDecoder::getObjectItem(const GenericNode* parent, const char* name,
-                                             bool case_insensitive) {
+const TapeNode* XMLDecoder::getObjectItem(const TapeNode* parent, const char* name,
+                                          bool case_insensitive) const {
     if (!parent || !name) {
         return parent;
     }
 
-    for (GenericNode* child = parent->child; child; child = child->next) {
-        if (child->key && (strlen(name) == child->key_size)) {
-            if (!case_insensitive) {
-                if (strncmp(name, child->key, child->key_size) == 0) {
-                    return child;
-                }
-            } else {
-                if (strcasecmp(name, std::string(child->key, child->key_size).c_str()) == 0) {
-                    return child;
-                }
+    const char* src = reader_->getSource();
+    const uint32_t name_size = (uint32_t)strlen(name);
+    if (!name_size) {
+        // array elements and text nodes have no key either
+        return NULL;
+    }
+    ShapeCache& shapes = reader_->getShapes();
+    const TapeNode* item = shapes.predict(parent);
+    if (item && item->keySize() == name_size &&
+        KeyIndex::equal(src + item->key, name, name_size, case_insensitive)) {
+        shapes.hit(item);
+        return item;
+    }
+
+    item = NULL;
+    if (parent->childCount() >= KeyIndex::MIN_CHILDREN) {
+        item = reader_->findKey(parent, name, name_size, case_insensitive);
+    } else {
+        for (const TapeNode* child = parent->child(); child; child = child->next()) {
+            if (child->keySize() == name_size &&
+                KeyIndex::equal(src + child->key, name, name_size, case_insensitive)) {
+                item = child;
+                break;
             }
         }
     }
-
-    return NULL;
+    shapes.bind(parent, item);
+    return item;
 }
 
-const GenericNode* XMLDecoder::getChild(const GenericNode* parent) {
+void XMLDecoder::enterShape(const void* type) { reader_->getShapes().enter(type, current_); }
+
+void XMLDecoder::leaveShape() { reader_->getShapes().leave(); }
+
+const TapeNode* XMLDecoder::getChild(const TapeNode* parent) {
     if (parent) {
-        return parent->child;
+        return parent->child();
     }
     return NULL;
 }
 
-const GenericNode* XMLDecoder::getNext(const GenericNode* parent) {
+const TapeNode* XMLDecoder::getNext(const TapeNode* parent) {
     if (parent) {
-        return parent->next;
+        return parent->next();
     }
     return NULL;
 }
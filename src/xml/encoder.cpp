@@ -3,10 +3,16 @@
 
 namespace serialflex {
 
-XMLEncoder::XMLEncoder(std::string& str, bool formatted) {
+XMLEncoder::XMLEncoder(std::string& str, bool formatted)
+    : formatted_(formatted), presize_(false), threads_(1) {
     writer_ = new xml::Writer(str, formatted);
 }
 
+XMLEncoder::XMLEncoder(OutputSink& sink, bool formatted)
+    : formatted_(formatted), presize_(false), threads_(1) {
+    writer_ = new xml::Writer(sink, formatted);
+}
+
 XMLEncoder::~XMLEncoder() {
     if (writer_) {
         delete writer_;
@@ -57,7 +63,13 @@ void XMLEncoder::encodeValue(const char* name, const double& value) {
 
 void XMLEncoder::encodeValue(const char* name, const std::string& value) {
     if (writer_) {
-        writer_->startKey(name).value(value).endKey(name);
+        writer_->startKey(name).value(value.data(), value.size()).endKey(name);
+    }
+}
+
+void XMLEncoder::encodeValue(const char* name, const StringRef& value) {
+    if (writer_) {
+        writer_->startKey(name).value(value.data(), value.size()).endKey(name);
     }
 }
 
@@ -90,4 +102,23 @@ bool XMLEncoder::writerResult() const {
     return false;
 }
 
+void XMLEncoder::writerExpect(size_t size) {
+    if (writer_) {
+        writer_->expect(size);
+    }
+}
+
+size_t XMLEncoder::writerSize() const {
+    if (writer_) {
+        return writer_->size();
+    }
+    return 0;
+}
+
+void XMLEncoder::writerWrite(const char* data, size_t size) {
+    if (writer_) {
+        writer_->write(data, size);
+    }
+}
+
 }// namespace serialflex
@@ -1,72 +1,55 @@
 #include <assert.h>
 #include <ctype.h>
 #include "reader.h"
+#include "../number/reader.h"
 
 namespace serialflex {
 
 namespace xml {
 
-Reader::Reader(): cur_value_(NULL), alloc_(values_) {}
+Reader::Reader(): cur_(0), src_(NULL), end_(NULL) {}
 
 Reader::~Reader() {}
 
-int64_t Reader::convertInt(const char* value, uint32_t length) {
-    if (!length) {
-        return 0;
+// element text may be indented around the number
+static inline void trimSpace(const char*& value, uint32_t& length) {
+    while (length && isspace((unsigned char)value[0])) {
+        ++value;
+        --length;
     }
-
-    int64_t result = 0;
-    bool bMinus = false;
-    if (value[0] == '-') {
-        bMinus = true;
-    }
-    for (uint32_t idx = bMinus; idx < length; ++idx) {
-        result *= 10;
-        result += value[idx] - '0';
-    }
-    if (bMinus) {
-        result = 0 - result;
+    while (length && isspace((unsigned char)value[length - 1])) {
+        --length;
     }
-    return result;
 }
 
-uint64_t Reader::convertUint(const char* value, uint32_t length) {
-    if (!length) {
-        return 0;
-    }
+bool Reader::convertInt(const char* value, uint32_t length, int32_t& result) {
+    trimSpace(value, length);
+    return number::parseInt32(value, length, result);
+}
 
-    uint64_t result = 0;
-    for (uint32_t idx = 0; idx < length; ++idx) {
-        result *= 10;
-        result += value[idx] - '0';
-    }
-    return result;
+bool Reader::convertInt(const char* value, uint32_t length, int64_t& result) {
+    trimSpace(value, length);
+    return number::parseInt64(value, length, result);
 }
 
-static inline double decimal(uint8_t n, uint32_t num) {
-    double db = n * 1.0f;
-    while (num--) {
-        db = db / 10;
-    }
-    return db;
+bool Reader::convertUint(const char* value, uint32_t length, uint32_t& result) {
+    trimSpace(value, length);
+    return number::parseUint32(value, length, result);
 }
 
-double Reader::convertDouble(const char* value, uint32_t length) {
-    if (!length) {
-        return 0.0f;
-    }
+bool Reader::convertUint(const char* value, uint32_t length, uint64_t& result) {
+    trimSpace(value, length);
+    return number::parseUint64(value, length, result);
+}
 
-    unsigned char* after_end = NULL;
-    unsigned char number_c_string[64] = {0};
+bool Reader::convertDouble(const char* value, uint32_t length, double& result) {
+    trimSpace(value, length);
+    return number::parseDouble(value, length, result);
+}
 
-    for (uint32_t idx = 0; idx < length; ++idx) {
-        number_c_string[idx] = value[idx];
-    }
-    double result = strtod((const char*)number_c_string, (char**)&after_end);
-    if (after_end != (number_c_string + length)) {
-        return 0.0f; /* parse_error */
-    }
-    return result;
+bool Reader::convertFloat(const char* value, uint32_t length, float& result) {
+    trimSpace(value, length);
+    return number::parseFloat(value, length, result);
 }
 
 unsigned char Reader::isHexChas(const unsigned char c) {
@@ -82,62 +65,61 @@ unsigned char Reader::isHexChas(const unsigned char c) {
     return 0xFF;
 }
 
-const GenericNode* Reader::parse(const char* src) {
+const TapeNode* Reader::parse(const char* src) {
+    end_ = NULL;
+    return parseDocument(src);
+}
+
+const TapeNode* Reader::parse(const char* src, size_t length, bool padded) {
+    end_ = padded ? NULL : src + length;
+    return parseDocument(src);
+}
+
+const TapeNode* Reader::parseDocument(const char* src) {
     assert(src);
+    src_ = src;
     // Parse BOM, if any
-    Reader::skipBom(src);
+    skipBom(src);
     // Skip whitespace before node
     skip<Reader::is_9_10_13_32>(src);
 
-    const char* text = src;
-    do {
-        ++alloc_;
-        // Parse children
-        for (;;) {
-            // Skip whitespace before node
-            skip<Reader::is_9_10_13_32>(src);
-            if (*src == 0) {
-                break;
-            }
-            // Parse
-            if (*src == '<') {
-                ++src;// Skip '<'
-                parseNode(src);
-            } else {
-                setError("expected <");
-                break;
-            }
-        }
-    } while (false);
+    tape_.clear();
+    keys_.clear();
+    scratch_.clear();
+    str_error_.clear();
 
-    //
-    alloc_.reSize();
-    GenericNode* root = alloc_.allocValue();
-    root->type = NODE_DOCUMENT;
-    cur_value_ = root;
+    const uint32_t root = tape_.append(NODE_DOCUMENT);
+    tape_.setLast(root);
+    uint32_t children = 0, last_child = 0;
     // Parse children
-    for (int32_t idx = 0;; ++idx) {
+    for (;;) {
         // Skip whitespace before node
-        skip<Reader::is_9_10_13_32>(text);
-        if (*text == 0) {
+        skip<Reader::is_9_10_13_32>(src);
+        if (at(src, 0) == 0) {
             break;
         }
         // Parse
-        if (*text == '<') {
-            ++text;// Skip '<'
-            GenericNode* temp = cur_value_;
-            parseNode(text);
-            cur_value_ = temp;
+        if (at(src, 0) == '<') {
+            ++src;// Skip '<'
+            last_child = tape_.size();
+            ++children;
+            parseNode(src);
+            cur_ = root;
         } else {
             setError("expected <");
             break;
         }
     }
+    if (str_error_.empty() && (size_t)(src - src_) > 0xFFFFFFFFU) {
+        // tape offsets are 32 bits
+        setError("document too large");
+    }
 
     if (!str_error_.empty()) {
         return NULL;
     }
-    return Reader::getResult(root);
+    tape_.closeContainer(root, children, last_child);
+    return getResult(tape_.root());
 }
 
 const char* Reader::getError() const {
@@ -147,13 +129,13 @@ const char* Reader::getError() const {
     return str_error_.c_str();
 }
 
-GenericNode* Reader::getResult(GenericNode* root) {
+const TapeNode* Reader::getResult(const TapeNode* root) const {
     if (!root) {
         return NULL;
     }
-    for (GenericNode* item = root->child; item; item = item->next) {
-        if (item->type == NODE_ELEMENT && item->key_size == strlen("serialflex") &&
-            strncmp("serialflex", item->key, item->key_size) == 0) {
+    for (const TapeNode* item = root->child(); item; item = item->next()) {
+        if (item->type() == NODE_ELEMENT && item->keySize() == strlen("serialflex") &&
+            strncmp("serialflex", src_ + item->key, item->keySize()) == 0) {
             return item;
         }
     }
@@ -161,9 +143,9 @@ GenericNode* Reader::getResult(GenericNode* root) {
 }
 
 void Reader::parseNode(const char*& src) {
-    allocNode();
+    cur_ = tape_.append(NODE_NULL);
     // Parse proper node type
-    switch (src[0]) {
+    switch (at(src, 0)) {
         // <...
         default: {
             // Parse and append element node
@@ -172,8 +154,9 @@ void Reader::parseNode(const char*& src) {
         // <?...
         case ('?'): {
             ++src;// Skip ?
-            if ((src[0] == 'x' || src[0] == 'X') && (src[1] == 'm' || src[1] == 'M') &&
-                (src[2] == 'l' || src[2] == 'L') && Reader::is_9_10_13_32(src[3])) {
+            if ((at(src, 0) == 'x' || at(src, 0) == 'X') &&
+                (at(src, 1) == 'm' || at(src, 1) == 'M') &&
+                (at(src, 2) == 'l' || at(src, 2) == 'L') && Reader::is_9_10_13_32(at(src, 3))) {
                 // '<?xml ' - xml declaration
                 src += 4;// Skip 'xml '
                 skipXmlDeclaration(src);
@@ -187,10 +170,10 @@ void Reader::parseNode(const char*& src) {
         // <!...
         case ('!'): {
             // Parse proper subset of <! node
-            switch (src[1]) {
+            switch (at(src, 1)) {
                 // <!-
                 case ('-'):
-                    if (src[2] == ('-')) {
+                    if (at(src, 2) == ('-')) {
                         // '<!--' - xml comment
                         src += 3;// Skip '!--'
                         skipComment(src);
@@ -199,8 +182,8 @@ void Reader::parseNode(const char*& src) {
                     break;
                     // <![
                 case ('['):
-                    if (src[2] == 'C' && src[3] == 'D' && src[4] == 'A' && src[5] == 'T' &&
-                        src[6] == 'A' && src[7] == '[') {
+                    if (at(src, 2) == 'C' && at(src, 3) == 'D' && at(src, 4) == 'A' &&
+                        at(src, 5) == 'T' && at(src, 6) == 'A' && at(src, 7) == '[') {
                         // '<![CDATA[' - cdata
                         parseCdata(src);
                         return;
@@ -208,8 +191,9 @@ void Reader::parseNode(const char*& src) {
                     break;
                     // <!D
                 case ('D'):
-                    if (src[2] == 'O' && src[3] == 'C' && src[4] == 'T' && src[5] == 'Y' &&
-                        src[6] == 'P' && src[7] == 'E' && Reader::is_9_10_13_32(src[8])) {
+                    if (at(src, 2) == 'O' && at(src, 3) == 'C' && at(src, 4) == 'T' &&
+                        at(src, 5) == 'Y' && at(src, 6) == 'P' && at(src, 7) == 'E' &&
+                        Reader::is_9_10_13_32(at(src, 8))) {
                         // '<!DOCTYPE ' - doctype
                         src += 9;// skip '!DOCTYPE '
                         skipDoctype(src);
@@ -220,8 +204,8 @@ void Reader::parseNode(const char*& src) {
 
             // Attempt to skip other, unrecognized node types starting with <!
             ++src;// Skip !
-            while (*src != '>') {
-                if (*src == 0) {
+            while (at(src, 0) != '>') {
+                if (at(src, 0) == 0) {
                     setError("unexpected end of data");
                     break;
                 }
@@ -252,12 +236,12 @@ bool Reader::parseElement(const char*& src) {
     skipNodeAttributes(src);
 
     // Determine ending type
-    if (*src == '>') {
+    if (at(src, 0) == '>') {
         ++src;
         parseNodeContents(src);
-    } else if (*src == '/') {
+    } else if (at(src, 0) == '/') {
         ++src;
-        if (*src != '>') {
+        if (at(src, 0) != '>') {
             setError("expected >");
             return false;
         }
@@ -270,6 +254,8 @@ bool Reader::parseElement(const char*& src) {
 }
 
 void Reader::parseNodeContents(const char*& src) {
+    const uint32_t element = cur_;
+    uint32_t children = 0, last_child = 0;
     // For all children and text
     for (;;) {
         if (getError()) {
@@ -277,7 +263,7 @@ void Reader::parseNodeContents(const char*& src) {
         }
         // Skip whitespace between > and node contents
         skip<Reader::is_9_10_13_32>(src);
-        const char next_char = *src;
+        const char next_char = at(src, 0);
 
         // After data nodes, instead of continuing the loop, control jumps here.
         // This is because zero termination inside parse_and_append_data() function
@@ -292,36 +278,53 @@ void Reader::parseNodeContents(const char*& src) {
         }
         if (next_char == '<') {
             // Node closing or child node
-            if (src[1] == '/') {
+            if (at(src, 1) == '/') {
                 // Node closing
                 src += 2;// Skip '</'
                 // Skip and validate closing tag name
                 const char* closing_name = src;
                 skip<Reader::is_not_0_9_10_13_32_47_62_63>(src);
-                if (cur_value_ &&
-                    !Reader::compare(cur_value_->key, cur_value_->key_size, closing_name,
+                const TapeNode& node = tape_.at(element);
+                if (!Reader::compare(src_ + node.key, node.keySize(), closing_name,
                                      uint32_t(src - closing_name), true)) {
                     setError("invalid closing tag name");
                     return;
                 }
                 // Skip remaining whitespace after node name
                 skip<Reader::is_9_10_13_32>(src);
-                if (*src != '>') {
+                if (at(src, 0) != '>') {
                     setError("expected >");
                     return;
                 }
                 ++src; // Skip '>'
+                if (children) {
+                    tape_.closeContainer(element, children, last_child);
+                }
                 return;// Node closed, finished parsing contents
             } else {
                 // Child node
                 ++src;// Skip '<'
-                GenericNode* temp = cur_value_;
+                const TapeNode text = tape_.at(element);
+                if (!children && text.value_size) {
+                    // text before the first child becomes a data node of its own
+                    last_child = tape_.append(NODE_DATA);
+                    tape_.setValue(last_child, text.value, text.value_size);
+                    tape_.setValue(element, 0, 0);
+                    ++children;
+                }
+                last_child = tape_.size();
+                ++children;
                 parseNode(src);
-                cur_value_ = temp;
+                cur_ = element;
             }
         } else {
-            // Data node
+            // Data node, the element keeps its text unless it has children
+            if (children) {
+                last_child = cur_ = tape_.append(NODE_DATA);
+                ++children;
+            }
             parseAndAppendData(src);
+            cur_ = element;
             // Bypass regular processing after data nodes
         }
     }
@@ -346,44 +349,47 @@ const char* Reader::skipAndExpandCharacterRefs(const char*& src) {
     skip<Reader::is_not_0_38_60>(src);
 
     // Use translation skip
-    for (; Reader::is_not_0_60(*src);) {
+    for (; Reader::is_not_0_60(at(src, 0));) {
         // Test if replacement is needed
-        if (src[0] == '&') {
-            if (src[1] == 'a') {
+        if (at(src, 0) == '&') {
+            if (at(src, 1) == 'a') {
                 // &amp; &apos;
-                if (src[2] == 'm' && src[3] == 'p' && src[4] == ';') {
+                if (at(src, 2) == 'm' && at(src, 3) == 'p' && at(src, 4) == ';') {
                     src += 5;
                     continue;
                 }
-                if (src[2] == 'p' && src[3] == 'o' && src[4] == 's' && src[5] == ';') {
+                if (at(src, 2) == 'p' && at(src, 3) == 'o' && at(src, 4) == 's' &&
+                    at(src, 5) == ';') {
                     src += 6;
                     continue;
                 }
-            } else if (src[1] == 'q') {
+            } else if (at(src, 1) == 'q') {
                 // &quot;
-                if (src[2] == 'u' && src[3] == 'o' && src[4] == 't' && src[5] == ';') {
+                if (at(src, 2) == 'u' && at(src, 3) == 'o' && at(src, 4) == 't' &&
+                    at(src, 5) == ';') {
                     src += 6;
                     continue;
                 }
-            } else if (src[1] == 'g') {
+            } else if (at(src, 1) == 'g') {
                 // &gt;
-                if (src[2] == 't' && src[3] == ';') {
+                if (at(src, 2) == 't' && at(src, 3) == ';') {
                     src += 4;
                     continue;
                 }
-            } else if (src[1] == 'l') {
+            } else if (at(src, 1) == 'l') {
                 // &lt;
-                if (src[2] == 't' && src[3] == ';') {
+                if (at(src, 2) == 't' && at(src, 3) == ';') {
                     src += 4;
                     continue;
                 }
-            } else if (src[1] == '#') {
+            } else if (at(src, 1) == '#') {
                 // &#...; - assumes ASCII
-                if (src[2] == 'x') {
+                if (at(src, 2) == 'x') {
                     unsigned long code = 0;
                     src += 3;// Skip &#x
                     while (1) {
-                        unsigned char digit = Reader::isHexChas(static_cast<unsigned char>(*src));
+                        unsigned char digit =
+                            Reader::isHexChas(static_cast<unsigned char>(at(src, 0)));
                         if (digit == 0xFF) {
                             break;
                         }
@@ -399,7 +405,8 @@ const char* Reader::skipAndExpandCharacterRefs(const char*& src) {
                     unsigned long code = 0;
                     src += 2;// Skip &#
                     while (1) {
-                        unsigned char digit = Reader::isHexChas(static_cast<unsigned char>(*src));
+                        unsigned char digit =
+                            Reader::isHexChas(static_cast<unsigned char>(at(src, 0)));
                         if (digit == 0xFF) {
                             break;
                         }
@@ -412,7 +419,7 @@ const char* Reader::skipAndExpandCharacterRefs(const char*& src) {
                         return NULL;
                     }
                 }
-                if (*src == ';') {
+                if (at(src, 0) == ';') {
                     ++src;
                 } else {
                     setError("expected ;");
@@ -428,49 +435,25 @@ const char* Reader::skipAndExpandCharacterRefs(const char*& src) {
     return src;
 }
 
-void Reader::setNodeType(const int32_t type) {
-    if (cur_value_) {
-        cur_value_->type = type;
-    }
-}
+void Reader::setNodeType(const int32_t type) { tape_.setType(cur_, type); }
 
 void Reader::setNodeKey(const char* key, const uint32_t key_size) {
-    if (cur_value_) {
-        cur_value_->key = key;
-        cur_value_->key_size = key_size;
+    if (key_size > TapeNode::KEY_SIZE_MAX) {
+        setError("element name too long");
+        return;
     }
+    tape_.setKey(cur_, uint32_t(key - src_), key_size);
 }
 
 void Reader::setNodeValue(const char* value, const uint32_t value_size) {
-    if (cur_value_) {
-        cur_value_->value = value;
-        cur_value_->value_size = value_size;
-    }
-}
-
-void Reader::allocNode() {
-    if (cur_value_) {
-        GenericNode* temp = cur_value_;
-        cur_value_ = alloc_.allocValue();
-        cur_value_->prev = temp;
-        for (GenericNode **child = &temp->child, *prev = temp;;
-             prev = *child, child = &(*child)->next) {
-            if (!*child) {
-                *child = cur_value_;
-                cur_value_->prev = prev;
-                break;
-            }
-        }
-    } else {
-        ++alloc_;
-    }
+    tape_.setValue(cur_, uint32_t(value - src_), value_size);
 }
 
 bool Reader::skipXmlDeclaration(const char*& src) {
     // parsing of declaration is disabled
     // Skip until end of declaration
-    while (src[0] != '?' || src[1] != '>') {
-        if (!src[0]) {
+    while (at(src, 0) != '?' || at(src, 1) != '>') {
+        if (!at(src, 0)) {
             setError("unexpected end of data");
             return false;
         }
@@ -485,8 +468,8 @@ bool Reader::skipXmlDeclaration(const char*& src) {
 bool Reader::skipPi(const char*& src) {
     // parsing of pi is disabled
     // Skip to '?>'
-    while (src[0] != '?' || src[1] != '>') {
-        if (*src == '\0') {
+    while (at(src, 0) != '?' || at(src, 1) != '>') {
+        if (at(src, 0) == '\0') {
             setError("unexpected end of data");
             return false;
         }
@@ -501,8 +484,8 @@ bool Reader::skipPi(const char*& src) {
 bool Reader::skipComment(const char*& src) {
     // parsing of comments is disabled
     // Skip until end of comment
-    for (; (src[0] != '-' || src[1] != '-' || src[2] != '>');) {
-        if (!src[0]) {
+    for (; (at(src, 0) != '-' || at(src, 1) != '-' || at(src, 2) != '>');) {
+        if (!at(src, 0)) {
             setError("unexpected end of data");
             return false;
         }
@@ -519,8 +502,8 @@ bool Reader::parseCdata(const char*& src) {
     // Skip until end of cdata
     const char* value = src;
     src += 8;// Skip '![CDATA['
-    while (src[0] != ']' || src[1] != ']' || src[2] != '>') {
-        if (!src[0]) {
+    while (at(src, 0) != ']' || at(src, 1) != ']' || at(src, 2) != '>') {
+        if (!at(src, 0)) {
             setError("unexpected end of data");
             return false;
         }
@@ -539,8 +522,8 @@ bool Reader::skipCdata(const char*& src) {
     // Skip until end of cdata
     const char* value = src;
     src += 8;// Skip '![CDATA['
-    while (src[0] != ']' || src[1] != ']' || src[2] != '>') {
-        if (!src[0]) {
+    while (at(src, 0) != ']' || at(src, 1) != ']' || at(src, 2) != '>') {
+        if (!at(src, 0)) {
             setError("unexpected end of data");
             return false;
         }
@@ -558,26 +541,26 @@ bool Reader::skipDoctype(const char*& src) {
     const char* value = src;
 
     // Skip to >
-    for (; *src != '>';) {
+    for (; at(src, 0) != '>';) {
         // Error on end of text
-        if (*src == '\0') {
+        if (at(src, 0) == '\0') {
             setError("unexpected end of data");
             return false;
         }
         // Determine character type
         // If '[' encountered, scan for matching ending ']' using naive algorithm with depth
         // This works for all W3C test files except for 2 most wicked
-        if (*src == '[') {
+        if (at(src, 0) == '[') {
             ++src;// Skip '['
             for (int depth = 1; depth > 0; ++src) {
-                if (*src == 0) {
+                if (at(src, 0) == 0) {
                     setError("unexpected end of data");
                     return false;
                 }
 
-                if (*src == '[') {
+                if (at(src, 0) == '[') {
                     ++depth;
-                } else if (*src == ']') {
+                } else if (at(src, 0) == ']') {
                     --depth;
                 }
             }
@@ -602,9 +585,10 @@ void Reader::skipNodeAttributes(const char*& src) {
     skip<Reader::is_not_0_9_10_13_32_33_47_60_61_62_63>(src);
 }
 
-void Reader::skipBom(const char*& src) {
-    if (static_cast<unsigned char>(src[0]) == 0xEF && static_cast<unsigned char>(src[1]) == 0xBB &&
-        static_cast<unsigned char>(src[2]) == 0xBF) {
+void Reader::skipBom(const char*& src) const {
+    if (static_cast<unsigned char>(at(src, 0)) == 0xEF &&
+        static_cast<unsigned char>(at(src, 1)) == 0xBB &&
+        static_cast<unsigned char>(at(src, 2)) == 0xBF) {
         src += 3;
     }
 }
@@ -2,10 +2,15 @@
 #define __XML_READER_H__
 
 #include <cstdlib>
+#include <stddef.h>
 #include <ctype.h>
 #include <stdio.h>
+#include <string.h>
 #include <string>
-#include "node.h"
+#include "key_index.h"
+#include "scratch.h"
+#include "shape_cache.h"
+#include "tape.h"
 
 namespace serialflex {
 
@@ -26,29 +31,58 @@ enum {
 };
 
 class Reader {
-    GenericNode* cur_value_;
-    std::vector<GenericNode> values_;
-    GenericNodeAllocator<GenericNode> alloc_;
+    Tape tape_;
+    KeyIndex keys_;
+    ShapeCache shapes_;// kept across parses
+    Scratch scratch_;
+    uint32_t cur_;   // tape index of the node being parsed
+    const char* src_;// start of the document, tape offsets are relative to it
+    const char* end_;// NULL when the input stops at '\0'
     std::string str_error_;
 
 public:
     Reader();
     ~Reader();
-    const GenericNode* parse(const char* src);
+    const TapeNode* parse(const char* src);
+    // padded: the input is followed by zero bytes, so '\0' still ends it
+    const TapeNode* parse(const char* src, size_t length, bool padded);
     const char* getError() const;
+    const char* getSource() const { return src_; }
+    // child of a wide object keyed name, through a table built on the first lookup
+    const TapeNode* findKey(const TapeNode* object, const char* name, uint32_t name_size,
+                            bool case_insensitive) {
+        return keys_.find(tape_, src_, object, name, name_size, case_insensitive);
+    }
+    // field order of the message types decoded so far
+    ShapeCache& getShapes() { return shapes_; }
+    // decoded text of StringRef fields, valid until the next parse
+    Scratch& getScratch() { return scratch_; }
+    void setError(const char* error) { str_error_ = error; }
 
-    static int64_t convertInt(const char* value, uint32_t length);
-    static uint64_t convertUint(const char* value, uint32_t length);
-    static double convertDouble(const char* value, uint32_t length);
+    // false on bad syntax or when the value does not fit
+    static bool convertInt(const char* value, uint32_t length, int32_t& result);
+    static bool convertInt(const char* value, uint32_t length, int64_t& result);
+    static bool convertUint(const char* value, uint32_t length, uint32_t& result);
+    static bool convertUint(const char* value, uint32_t length, uint64_t& result);
+    static bool convertDouble(const char* value, uint32_t length, double& result);
+    static bool convertFloat(const char* value, uint32_t length, float& result);
     // in
     // '0'、'1'、'2'、'3'、'4'、'5'、'6'、'7'、'8'、'9'
     // 、'A'、'B'、'C'、'D'、'E'、'F'、'a'、'b'、'c'、'd'、'e'、'f'
     static unsigned char isHexChas(const unsigned char c);
 
 private:
-    void setError(const char* error) { str_error_ = error; }
 
-    static GenericNode* getResult(GenericNode* root);
+    const TapeNode* getResult(const TapeNode* root) const;
+    const TapeNode* parseDocument(const char* src);
+
+    // character at src[idx], '\0' past the end of the input
+    char at(const char* src, const size_t idx) const {
+        if (end_ && end_ - src <= (ptrdiff_t)idx) {
+            return '\0';
+        }
+        return src[idx];
+    }
 
     void parseNode(const char*& src);
     bool parseElement(const char*& src);
@@ -61,7 +95,6 @@ private:
     void setNodeType(const int32_t type);
     void setNodeKey(const char* key, const uint32_t key_size);
     void setNodeValue(const char* value, const uint32_t value_size);
-    void allocNode();
 
     bool skipXmlDeclaration(const char*& src);
     bool skipPi(const char*& src);
@@ -69,12 +102,12 @@ private:
     bool skipCdata(const char*& src);
     bool skipDoctype(const char*& src);
     void skipNodeAttributes(const char*& src);
-    static void skipBom(const char*& src);
+    void skipBom(const char*& src) const;
 
     // skip
     template <bool (*f)(const char)>
-    static void skip(const char*& src) {
-        for (; f(*src);) {
+    void skip(const char*& src) const {
+        for (; f(at(src, 0));) {
             ++src;
         }
     }
@@ -1,100 +1,144 @@
 #include <assert.h>
-#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <number/writer.h>
 #include "writer.h"
 
 namespace serialflex {
 
 namespace xml {
 
-Writer::Writer(std::string& str, bool formatted): str_(str), formatted_(formatted), layer_(0) {
-    str_.append("<?xml version=\"1.0\" encoding=\"utf-8\"?>");
+Writer::Writer(std::string& str, bool formatted)
+    : string_sink_(new StringSink(str)), sink_(*string_sink_), formatted_(formatted), layer_(0) {
+    declaration();
+}
+
+Writer::Writer(OutputSink& sink, bool formatted)
+    : string_sink_(NULL), sink_(sink), formatted_(formatted), layer_(0) {
+    declaration();
+}
+
+Writer::~Writer() { delete string_sink_; }
+
+template <typename T>
+void Writer::appendNumber(T value) {
+    if (sink_.room() >= number::MAX_NUMBER_SIZE) {
+        sink_.advance(number::formatNumber(value, sink_.cursor()));
+    } else {
+        // the end of a fixed buffer may still hold this one
+        char buffer[number::MAX_NUMBER_SIZE];
+        sink_.write(buffer, number::formatNumber(value, buffer));
+    }
+}
+
+void Writer::declaration() {
+    sink_.write("<?xml version=\"1.0\" encoding=\"utf-8\"?>");
     if (formatted_) {
-        str_.append(1, '\n');
+        sink_.put('\n');
     }
 }
 
 Writer& Writer::startKey(const char* key) {
     if (key) {
-        tab(str_, layer_);
-        str_.append(1, '<').append(key).append(1, '>');
+        tab(layer_);
+        appendTag(key, 0);
     }
     return *this;
 }
 
 Writer& Writer::endKey(const char* key) {
     if (key) {
-        str_.append(1, '<').append(1, '/').append(key).append(1, '>');
-        if (formatted_) {
-            str_.append(1, '\n');
-        }
+        appendTag(key, 1);
     }
     return *this;
 }
 
 Writer& Writer::value(bool b) {
     if (b) {
-        str_.append("true");
+        sink_.write("true", 4);
     } else {
-        str_.append("false");
+        sink_.write("false", 5);
     }
 
     return *this;
 }
 
 Writer& Writer::value(int64_t i64) {
-    char buffer[32] = {0};
-    snprintf(buffer, 32, "%lld", i64);
-    str_.append(buffer);
+    appendNumber(i64);
 
     return *this;
 }
 
 Writer& Writer::value(uint64_t u64) {
-    char buffer[32] = {0};
-    snprintf(buffer, 32, "%llu", u64);
-    str_.append(buffer);
+    appendNumber(u64);
 
     return *this;
 }
 
 Writer& Writer::value(double d) {
-    char buffer[64] = {0};
-    snprintf(buffer, 64, "%lf", d);
-    str_.append(buffer);
+    appendNumber(d);
 
     return *this;
 }
 
-Writer& Writer::value(const std::string& value) {
-    if ((value.find("![CDATA[") == 0) && (value.find("]]") == value.size() - 2)) {
-        str_.append(1, '<').append(value).append(1, '>');
+Writer& Writer::value(float f) {
+    appendNumber(f);
+
+    return *this;
+}
+
+// "![CDATA[...]]" whose first "]]" is the end, written without escaping
+static bool isCData(const char* value, size_t size) {
+    if (size < 10 || memcmp(value, "![CDATA[", 8) != 0) {
+        return false;
+    }
+    for (size_t idx = 8; idx + 1 < size; ++idx) {
+        if (value[idx] == ']' && value[idx + 1] == ']') {
+            return (idx + 2 == size);
+        }
+    }
+    return false;
+}
+
+Writer& Writer::value(const char* value, size_t size) {
+    if (isCData(value, size)) {
+        sink_.put('<');
+        sink_.write(value, size);
+        sink_.put('>');
     } else {
-        for (const char& c : value) {
+        const char* run = value;
+        for (const char *ptr = value, *end = value + size; ptr != end; ++ptr) {
+            const char* entity = NULL;
+            const char c = *ptr;
             if (c == '<') {
-                str_.append("&lt;");
+                entity = "&lt;";
             } else if (c == '>') {
-                str_.append("&gt;");
+                entity = "&gt;";
             } else if (c == '\'') {
-                str_.append("&apos;");
+                entity = "&apos;";
             } else if (c == '"') {
-                str_.append("&quot;");
+                entity = "&quot;";
             } else if (c == '&') {
-                str_.append("&amp;");
+                entity = "&amp;";
             } else {
-                str_.append(1, c);
+                continue;
             }
+            // the characters up to here need no escape and go out in one piece
+            sink_.write(run, (size_t)(ptr - run));
+            sink_.write(entity);
+            run = ptr + 1;
         }
+        sink_.write(run, (size_t)(value + size - run));
     }
 
     return *this;
 }
 
 void Writer::startObject(const char* name) {
-    tab(str_, layer_);
-    str_.append(1, '<').append(name).append(1, '>');
+    tab(layer_);
+    appendTag(name, 0);
     if (formatted_) {
-        str_.append(1, '\n');
+        sink_.put('\n');
     }
 
     layer_++;
@@ -104,17 +148,45 @@ void Writer::endObject(const char* name) {
     assert(layer_ > 0);
     layer_--;
 
-    tab(str_, layer_);
-    str_.append(1, '<').append(1, '/').append(name).append(1, '>');
+    tab(layer_);
+    appendTag(name, 1);
+}
+
+void Writer::appendTag(const char* name, uint32_t index) {
+    uint32_t size = 0;
+    const char* token = keys_.find(name, index, size);
+    if (token) {
+        sink_.write(token, size);
+        return;
+    }
+    // an end tag meets the name of its element a second time, only start tags count
+    if (index || !keys_.repeated(name)) {
+        if (index) {
+            sink_.write("</", 2);
+        } else {
+            sink_.put('<');
+        }
+        sink_.write(name);
+        sink_.put('>');
+        if (index && formatted_) {
+            sink_.put('\n');
+        }
+        return;
+    }
+    // both tags are rendered at once, later elements of this name copy them out
+    tokens_[0].assign(1, '<').append(name).append(1, '>');
+    tokens_[1].assign("</", 2).append(name).append(1, '>');
     if (formatted_) {
-        str_.append(1, '\n');
+        tokens_[1].append(1, '\n');
     }
+    keys_.insert(name, (uint32_t)strlen(name), tokens_, 2);
+    sink_.write(tokens_[0].data(), tokens_[0].size());
 }
 
-void Writer::tab(std::string& str, int32_t layer) const {
+void Writer::tab(int32_t layer) const {
     if (formatted_) {
         for (int32_t idx = 0; idx < layer; ++idx) {
-            str.append(1, '\t');
+            sink_.put('\t');
         }
     }
 }
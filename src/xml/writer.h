@@ -2,6 +2,8 @@
 #define __XML_WRITER_H__
 
 #include <stdint.h>
+#include <serialflex/sink.h>
+#include <key_tokens.h>
 #include <string>
 #include <utility>
 #include <vector>
@@ -11,12 +13,20 @@ namespace serialflex {
 namespace xml {
 
 class Writer {
-    std::string& str_;
+    StringSink* string_sink_;// owned when writing into a string
+    OutputSink& sink_;
     bool formatted_;
     int32_t layer_;
+    KeyTokens keys_;       // <name> and </name> per element name
+    std::string tokens_[2];// an element name being rendered
+
+    Writer(const Writer&);
+    Writer& operator=(const Writer&);
 
 public:
     explicit Writer(std::string& str, bool formatted = false);
+    explicit Writer(OutputSink& sink, bool formatted = false);
+    ~Writer();
     // key and value
     Writer& startKey(const char* key);
     Writer& endKey(const char* key);
@@ -24,16 +34,30 @@ public:
     Writer& value(int64_t i64);
     Writer& value(uint64_t u64);
     Writer& value(double d);
-    Writer& value(const std::string& value);
+    Writer& value(float f);
+    Writer& value(const char* value, size_t size);
     //
     void startObject(const char* name);
     void endObject(const char* name);
 
-    bool result() const { return (layer_ == 0); }
+    // about size more bytes are coming
+    void expect(size_t size) { sink_.expect(size); }
+    // bytes written so far
+    size_t size() const { return sink_.size(); }
+    // text written elsewhere, as it is
+    void write(const char* data, size_t size) { sink_.write(data, size); }
+    // the document is complete and handed to the sink
+    bool result() { return (layer_ == 0) && sink_.flush(); }
 
 private:
+    void declaration();
+    // <name> for index 0, </name> with the line break of formatted output for index 1
+    void appendTag(const char* name, uint32_t index);
+    // formatted straight into the sink when it has room for the longest number
+    template <typename T>
+    void appendNumber(T value);
     // \t
-    void tab(std::string& str, int32_t layer) const;
+    void tab(int32_t layer) const;
 };
 
 }// namespace xml
@@ -29,10 +29,29 @@ bool ClassGenerator::Generate(const FileDescriptor* file, const string& paramete
     std::vector<std::pair<string, string> > options;
     ParseGeneratorParameter(parameter, &options);
 
+    // --serialize_opt=map=unordered|flat picks the container of map fields, std::map otherwise
+    CodeSerialize::MapType map_type = CodeSerialize::MAP_STD;
+    for (size_t i = 0; i < options.size(); ++i) {
+        if (options[i].first != "map") {
+            *error = "Unknown generator option: " + options[i].first;
+            return false;
+        }
+        if (options[i].second == "std") {
+            map_type = CodeSerialize::MAP_STD;
+        } else if (options[i].second == "unordered") {
+            map_type = CodeSerialize::MAP_UNORDERED;
+        } else if (options[i].second == "flat") {
+            map_type = CodeSerialize::MAP_FLAT;
+        } else {
+            *error = "Unknown map container: " + options[i].second;
+            return false;
+        }
+    }
+
     Options file_options;
     string basename = StripProto(file->name());
     FileGenerator file_generator(file, file_options);
-    compiler::cpp::CodeSerialize obj(file, file_options);
+    compiler::cpp::CodeSerialize obj(file, file_options, map_type);
 
     google::protobuf::scoped_ptr<io::ZeroCopyOutputStream> outputHeader(
         generator_context->Open(basename + ".pb.h"));
@@ -194,8 +194,9 @@ public:
     }
 };
 /*--------------------------------------------------------------------------------*/
-CodeSerialize::CodeSerialize(const FileDescriptor* file, const Options& options)
-    : scc_analyzer_(options), _file(file) {
+CodeSerialize::CodeSerialize(const FileDescriptor* file, const Options& options,
+                             MapType map_type)
+    : scc_analyzer_(options), _file(file), _map_type(map_type) {
     prepareMsgs();
 }
 
@@ -290,7 +291,13 @@ void CodeSerialize::printInclude(google::protobuf::io::Printer& printer) const {
         printer.Print("#include <vector>\n");
     }
     if (hasMap(printer)) {
-        printer.Print("#include <map>\n");
+        if (_map_type == MAP_UNORDERED) {
+            printer.Print("#include <unordered_map>\n");
+        } else if (_map_type == MAP_FLAT) {
+            printer.Print("#include <serialflex/flat_map.h>\n");
+        } else {
+            printer.Print("#include <map>\n");
+        }
     }
     // import
     std::set<string> public_import_names;
@@ -358,7 +365,7 @@ void CodeSerialize::printDeclare(google::protobuf::io::Printer& printer,
     for (uint32_t idx = 0, flag = 0; idx < message_size; ++idx) {
         if (const FieldDescriptor* field = messages._vec.at(idx)) {
             if (field->is_map()) {
-                printer.Print("    std::map<$type$>", "type", map2string(*field));
+                printer.Print("    $type$", "type", mapType(*field));
             } else if (field->is_repeated()) {
                 printer.Print("    std::vector<$type$>", "type", type2string(*field));
             } else {
@@ -389,7 +396,7 @@ void CodeSerialize::printGetSetHas(google::protobuf::io::Printer& printer,
             std::string field_name(FieldName(*field));
             std::string field_type;
             if (field->is_map()) {
-                field_type.append("std::map<").append(map2string(*field)).append(">");
+                field_type.append(mapType(*field));
             } else if (field->is_repeated()) {
                 field_type.append("std::vector<").append(type2string(*field)).append(">");
             } else {
@@ -558,6 +565,19 @@ bool CodeSerialize::hasMap(google::protobuf::io::Printer& printer) const {
     return false;
 }
 
+std::string CodeSerialize::mapType(const FieldDescriptor& field) const {
+    std::string result;
+    if (_map_type == MAP_UNORDERED) {
+        result.append("std::unordered_map<");
+    } else if (_map_type == MAP_FLAT) {
+        result.append("serialflex::FlatMap<");
+    } else {
+        result.append("std::map<");
+    }
+    result.append(map2string(field)).append(">");
+    return result;
+}
+
 std::string CodeSerialize::FieldName(const FieldDescriptor& field) {
     string result = field.name();
     LowerString(&result);
@@ -17,6 +17,15 @@ namespace cpp {
 struct Options;
 
 class CodeSerialize {
+public:
+    // container of map fields
+    enum MapType {
+        MAP_STD,      // std::map
+        MAP_UNORDERED,// std::unordered_map, needs C++11
+        MAP_FLAT,     // serialflex::FlatMap
+    };
+
+private:
     struct FieldDescriptorArr {
         std::vector<const FieldDescriptor*> _vec;
         std::string _name;
@@ -24,9 +33,11 @@ class CodeSerialize {
     std::vector<FieldDescriptorArr> _message_generators;
     SCCAnalyzer scc_analyzer_;
     const FileDescriptor* _file;
+    MapType _map_type;
 
 public:
-    CodeSerialize(const FileDescriptor* file, const Options& options);
+    CodeSerialize(const FileDescriptor* file, const Options& options,
+                  MapType map_type = MAP_STD);
     ~CodeSerialize();
 
     void printHeader(google::protobuf::io::Printer& printer, const char* szName) const;
@@ -54,6 +65,7 @@ private:
     bool hasString(google::protobuf::io::Printer& printer) const;
     bool hasVector(google::protobuf::io::Printer& printer) const;
     bool hasMap(google::protobuf::io::Printer& printer) const;
+    std::string mapType(const FieldDescriptor& field) const;
 };
 
 }// namespace cpp